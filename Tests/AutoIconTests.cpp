@@ -0,0 +1,1359 @@
+﻿// AutoICON 测试
+// 把 main.cpp 与 Tests/shim 下的最小 Win32 兼容层一起编译，在 Linux 下检查与平台无关的部分：
+// 弹簧解析解、曲线与静止时刻预测、线程间的数据结构。在仓库根目录构建并运行：
+//     g++ -std=c++11 -O2 -pthread -ITests/shim Tests/AutoIconTests.cpp -o AutoIconTests && ./AutoIconTests
+//     g++ -std=c++11 -O1 -g -pthread -fsanitize=thread -ITests/shim Tests/AutoIconTests.cpp -o AutoIconTests_tsan && ./AutoIconTests_tsan
+// 加 -DSPRING_FIXED_POINT 检查定点路径。测试总是定义 LOCK_STATS，Stress 在结束时输出各把锁的持有时长。以 / 开头的参数原样转给 wWinMain，可在 Linux 下运行命令行工具：
+//     ./AutoIconTests /bench bench.csv
+// 基准不在默认运行之列，只输出数字不做检查：./AutoIconTests bench 运行全部，或给出名字运行其中一个。
+// 返回值为失败的检查数
+#define LOCK_STATS
+#include "../main.cpp"
+#include <locale.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+// 帧记录分析工具的解码部分，与 main.cpp 的写出部分互相验证。FLIGHT_MAGIC 与 FLIGHT_VERSION 两边同值，
+// 以工具中的定义为准；工具整体放进命名空间 (它用到的标准头已在上面包含)，其 main 与 Percentile 不与本文件冲突
+#undef FLIGHT_MAGIC
+#undef FLIGHT_VERSION
+namespace FlightAnalyzer {
+#include "../Tools/FlightAnalyzer.cpp"
+}
+
+int g_TestFailures = 0;
+
+#define CHECK(cond) do { if (!(cond)) { printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); g_TestFailures++; } } while (0)
+#define CHECK_NEAR(a, b, tol) do { double va_ = (a), vb_ = (b); if (!(fabs(va_ - vb_) <= (tol))) { \
+    printf("FAIL %s:%d: %s = %g, %s = %g\n", __FILE__, __LINE__, #a, va_, #b, vb_); g_TestFailures++; } } while (0)
+
+// --- 弹簧与曲线 ---
+
+// 以极小步长的 RK4 积分作为参考解
+void ReferenceSpring(double& x, double& v, const SpringParams& p, double t) {
+    const int n = 100000;
+    double h = t / n;
+    for (int i = 0; i < n; i++) {
+        double k1x = v, k1v = -p.tension * x - p.friction * v;
+        double k2x = v + 0.5 * h * k1v, k2v = -p.tension * (x + 0.5 * h * k1x) - p.friction * (v + 0.5 * h * k1v);
+        double k3x = v + 0.5 * h * k2v, k3v = -p.tension * (x + 0.5 * h * k2x) - p.friction * (v + 0.5 * h * k2v);
+        double k4x = v + h * k3v, k4v = -p.tension * (x + h * k3x) - p.friction * (v + h * k3v);
+        x += h / 6.0 * (k1x + 2.0 * k2x + 2.0 * k3x + k4x);
+        v += h / 6.0 * (k1v + 2.0 * k2v + 2.0 * k3v + k4v);
+    }
+}
+
+void TestSolveSpring() {
+    // 欠阻尼、临界阻尼、过阻尼各取几组
+    const SpringParams springs[] = { SP_FAST, SP_NORMAL, SP_SLOW, SP_VERYSLOW, MakeSpring(100.0f, 20.0f), MakeSpring(100.0f, 45.0f) };
+    const float times[] = { 0.004f, 0.05f, 0.3f, 1.5f };
+    for (int i = 0; i < (int)_countof(springs); i++) {
+        for (int j = 0; j < (int)_countof(times); j++) {
+            float x = 40.0f, v = -300.0f;
+            SolveSpring(x, v, 10.0f, springs[i], times[j]);
+            double rx = 30.0, rv = -300.0;
+            ReferenceSpring(rx, rv, springs[i], times[j]);
+            CHECK_NEAR(x, 10.0 + rx, 1e-4 * (1.0 + fabs(rx)));
+            CHECK_NEAR(v, rv, 1e-4 * (1.0 + fabs(rv)));
+        }
+
+        // 解析解与步长无关：一步走完与分两步走的结果一致
+        float x1 = 0.0f, v1 = 0.0f, x2 = 0.0f, v2 = 0.0f;
+        SolveSpring(x1, v1, 255.0f, springs[i], 0.25f);
+        SolveSpring(x2, v2, 255.0f, springs[i], 0.1f);
+        SolveSpring(x2, v2, 255.0f, springs[i], 0.15f);
+        CHECK_NEAR(x1, x2, 1e-3);
+        CHECK_NEAR(v1, v2, 1e-3 * (1.0 + fabs(v1)));
+    }
+
+    // 禁用的弹簧不改变状态；极端参数不产生 NaN
+    float x = 5.0f, v = 1.0f;
+    SolveSpring(x, v, 0.0f, SP_OFF, 0.1f);
+    CHECK(x == 5.0f && v == 1.0f);
+    SolveSpring(x, v, 0.0f, MakeSpring(1e6f, 1e-3f), 1e6f);
+    CHECK(!_isnan(x) && !_isnan(v));
+}
+
+// 烘焙的曲线表：每条 CURVE_SAMPLES 个采样点，间隔为整微秒且覆盖到单位响应衰减完毕；
+// 采样点与解析解一致，相邻采样点之间的线性插值误差不足 1 个渲染单位 (位移按整屏高度计)
+void TestSpringCurves() {
+    BakeSpringCurves();
+    CHECK(_countof(g_Curves[0].s) == CURVE_SAMPLES);
+    for (int i = 0; i < g_CurveCount; i++) {
+        const SpringCurve& c = g_Curves[i];
+        const SpringParams& p = c.params;
+        double step = c.stepUs * 1e-6;
+        double duration = (p.duration > 0.0f) ? p.duration : (log(1.0 / CURVE_SETTLE_RATIO) + 1.0) / SpringDecayRate(p);
+        CHECK(c.stepUs > 0);
+        CHECK(step * (CURVE_SAMPLES - 1) >= duration && step * (CURVE_SAMPLES - 2) < duration);
+        CHECK_NEAR(c.invStep * step, 1.0, 1e-6);
+
+        double maxInterp = 0.0;
+        for (int k = 0; k < CURVE_SAMPLES; k++) {
+            float t = (float)(k * step);
+            float x = 1.0f, v = 0.0f, xv = 0.0f, vv = 1.0f;
+            if (p.duration > 0.0f) {
+                double ease = 1.0, slope = 0.0;
+                if (t < p.duration) CubicBezierEase(p.bezier, t / p.duration, ease, slope);
+                x = (float)(1.0 - ease);
+                v = (float)(-slope / p.duration);
+                xv = vv = 0.0f;
+            }
+            else {
+                SolveSpring(x, v, 0.0f, p, t);
+                SolveSpring(xv, vv, 0.0f, p, t);
+            }
+            CHECK_NEAR(c.s[k].pos, x, 1e-6);
+            CHECK_NEAR(c.s[k].vel, v, 1e-6 * (1.0 + fabs(v)));
+            CHECK_NEAR(c.s[k].posV, xv, 1e-6);
+            CHECK_NEAR(c.s[k].velV, vv, 1e-6);
+#ifdef SPRING_FIXED_POINT
+            CHECK_NEAR(c.q[k].pos, x * (1 << FIXED_CURVE_SHIFT), 1.0);
+            CHECK_NEAR(c.q[k].posV, xv * (1 << FIXED_CURVE_SHIFT), 1.0);
+#endif
+
+            // 两个采样点中间的插值与解析解之差
+            if (k < CURVE_SAMPLES - 1 && p.duration <= 0.0f) {
+                float xm = 1.0f, vm = 0.0f;
+                SolveSpring(xm, vm, 0.0f, p, (float)((k + 0.5) * step));
+                double err = fabs((c.s[k].pos + c.s[k + 1].pos) * 0.5 - xm);
+                if (err > maxInterp) maxInterp = err;
+            }
+        }
+        CHECK(maxInterp * BENCH_SCREEN_H < 1.0);
+        if (p.duration <= 0.0f) CHECK(fabs(c.s[CURVE_SAMPLES - 1].pos) < CURVE_SETTLE_RATIO);
+        else CHECK(c.s[CURVE_SAMPLES - 1].pos == 0.0f);
+        printf("  %d: step %d us, interp %.2g\n", i, c.stepUs, maxInterp * BENCH_SCREEN_H);
+    }
+}
+
+void SetLaneRange(SpringBank& b, int lane, float lo, float hi) {
+    b.lo[lane] = lo;
+    b.hi[lane] = hi;
+#ifdef SPRING_FIXED_POINT
+    b.qLo[lane] = FixedFromFloat(lo, FIXED_VALUE_SHIFT);
+    b.qHi[lane] = FixedFromFloat(hi, FIXED_VALUE_SHIFT);
+#endif
+}
+
+// 按曲线采样的线性插值独立求值 (钳制后)，与 BankValueAt 不共用代码
+float CurveValue(const SpringBank& b, int lane, float t) {
+    const SpringCurve* c = b.curve[lane];
+    double fi = t * c->invStep;
+    if (fi >= CURVE_SAMPLES - 1) fi = CURVE_SAMPLES - 1;
+    int k = (int)fi;
+    if (k > CURVE_SAMPLES - 2) k = CURVE_SAMPLES - 2;
+    double f = fi - k;
+    double pos = c->s[k].pos + (c->s[k + 1].pos - c->s[k].pos) * f;
+    double posV = c->s[k].posV + (c->s[k + 1].posV - c->s[k].posV) * f;
+    double v = b.target[lane] + b.startPos[lane] * pos + b.startVel[lane] * posV;
+    if (v < b.lo[lane]) v = b.lo[lane];
+    if (v > b.hi[lane]) v = b.hi[lane];
+    return (float)v;
+}
+
+void TestBankSettleTime() {
+    BakeSpringCurves();
+    CHECK(g_CurveCount > 0);
+
+    struct Case { float from, to, lo, hi, vel; };
+    const Case cases[] = {
+        { 0.0f, 1080.0f, -FLT_MAX, FLT_MAX, 0.0f },
+        { 1080.0f, 0.0f, -FLT_MAX, FLT_MAX, -2000.0f },
+        { 0.0f, 255.0f, 0.0f, 255.0f, 0.0f },
+        { 255.0f, 0.0f, 0.0f, 255.0f, 0.0f },
+        { 40.0f, 255.0f, 0.0f, 255.0f, 900.0f }
+    };
+
+    for (int i = 0; i < g_CurveCount; i++) {
+        const SpringParams& p = g_Curves[i].params;
+        for (int j = 0; j < (int)_countof(cases); j++) {
+            SpringBank b;
+            memset(&b, 0, sizeof(b));
+            SetLaneRange(b, 0, cases[j].lo, cases[j].hi);
+            BankSet(b, 0, cases[j].from);
+            b.vel[0] = (p.duration > 0.0f) ? 0.0f : cases[j].vel; // 缓动曲线不继承初速度
+            BankRetarget(b, 0, cases[j].to, p);
+            CHECK(b.curve[0] == &g_Curves[i]);
+
+            // 预测的静止时刻之后，任意时刻的渲染值都等于目标；其前一个采样点仍不等于目标
+            float settle = b.settleTime[0];
+            float step = 1.0f / g_Curves[i].invStep;
+            int final = RenderQuantize(cases[j].to);
+            CHECK(settle > 0.0f);
+            for (float t = settle; t < step * CURVE_SAMPLES; t += step * 0.37f) {
+                if (RenderQuantize(CurveValue(b, 0, t)) != final) {
+                    CHECK(RenderQuantize(CurveValue(b, 0, t)) == final);
+                    break;
+                }
+            }
+            CHECK(RenderQuantize(CurveValue(b, 0, settle - step)) != final);
+
+            // 逐帧推进同样在静止时刻之后停在目标，之前则至少有一帧渲染值不同于目标
+            bool changedBefore = false, stuckAfter = true;
+            for (int n = 0; n < 240 * 30; n++) {
+                float before = b.elapsed[0];
+                BankStep(b, 1.0f / 240.0f);
+                if (before >= settle + 1e-3f) stuckAfter = stuckAfter && (b.pos[0] == cases[j].to);
+                else if (RenderQuantize(b.pos[0]) != final) changedBefore = true;
+            }
+            CHECK(changedBefore);
+            CHECK(stuckAfter);
+        }
+    }
+}
+
+// 代表性预设的一次过渡所需的物理步数：不早于任何通道的渲染值最后一次变化，
+// 且最多比它晚一个采样间隔加一步 (静止时刻按采样点预测)。步数同时与记录值比较，
+// 曲线烘焙或静止预测的改动会在这里显现
+void TestSettleSteps() {
+    BenchInit();
+    const int presets[] = { 0, 2, 5, 8 }; // 渐变、抽屉、滑动 (快速)、抽屉 (缓动)
+    const int expected[][2] = { { 47, 121 }, { 100, 159 }, { 98, 123 }, { 21, 24 } }; // 显示、隐藏
+    for (int j = 0; j < (int)_countof(presets); j++) {
+        for (int hide = 0; hide < 2; hide++) {
+            int steps = BenchTransition(PRESETS[presets[j]], hide != 0, NULL);
+            float h = ActivePhysicsStep();
+            CHECK(steps < BENCH_MAX_STEPS);
+
+            int lastChange = 0, slack = 1;
+            for (int i = 0; i < BENCH_LANES; i++) {
+                const SpringBank& b = g_Render.bank;
+                if (!b.curve[i]) continue;
+                int final = RenderQuantize(b.target[i]);
+                for (int n = 1; n <= BENCH_MAX_STEPS; n++) {
+                    if (RenderQuantize(CurveValue(b, i, n * h)) != final) lastChange = std::max(lastChange, n);
+                }
+                slack = std::max(slack, (int)ceil(1.0f / (b.curve[i]->invStep * h)) + 1);
+            }
+            printf("  preset %d %s: %d steps (last change %d)\n", presets[j], hide ? "hide" : "show", steps, lastChange);
+            CHECK(steps > lastChange);
+            CHECK(steps <= lastChange + slack);
+            CHECK(steps == expected[j][hide]);
+        }
+    }
+}
+
+// 旧的主循环：每帧以帧间隔直接求解一次弹簧，透明度钳制在状态上，
+// 直到 |Δ| < 1 且 |v| < 2 (即 IsChannelIdle 未起段时的退回判断) 才停止。返回所需帧数
+int LegacyIdleFrames(const ConfigProfile& profile, bool hide) {
+    const SpringParams& motion = hide ? profile.motionOut : profile.motionIn;
+    const SpringParams& opacity = hide ? profile.opacityOut : profile.opacityIn;
+    float y = hide ? 0.0f : (float)BENCH_SCREEN_H, vy = 0.0f, targetY = hide ? (float)BENCH_SCREEN_H : 0.0f;
+    float a = hide ? 255.0f : 0.0f, va = 0.0f, targetA = hide ? 0.0f : 255.0f;
+    int frames = 0;
+    while (frames < BENCH_MAX_STEPS) {
+        if (motion.enabled) SolveSpring(y, vy, targetY, motion, BENCH_FRAME_DT);
+        if (opacity.enabled) SolveSpring(a, va, targetA, opacity, BENCH_FRAME_DT);
+        if (a < 0.0f) a = 0.0f;
+        if (a > 255.0f) a = 255.0f;
+        frames++;
+        bool yIdle = !motion.enabled || (fabs(targetY - y) < 1.0f && fabs(vy) < 2.0f);
+        bool aIdle = !opacity.enabled || (fabs(targetA - a) < 1.0f && fabs(va) < 2.0f);
+        if (yIdle && aIdle) break;
+    }
+    return frames;
+}
+
+// 在 60 Hz 虚拟显示器上，按渲染量化判断静止 (连同据此降频的尾段) 实际提交的帧数
+// 少于旧主循环按阈值判断所需的帧数。缓动预设在阈值判断之后才加入，不参与比较
+void TestQuantizedIdle() {
+    BenchInit();
+    for (int p = 0; p < PRESET_COUNT; p++) {
+        const ConfigProfile& profile = PRESETS[p];
+        if (profile.motionIn.duration > 0.0f || profile.opacityIn.duration > 0.0f) continue;
+        for (int hide = 0; hide < 2; hide++) {
+            PacingStats stats;
+            PacingTransition(profile, hide != 0, 60, false, &stats);
+            int legacy = LegacyIdleFrames(profile, hide != 0);
+            printf("  preset %d %s: %d frames, threshold %d\n", p, hide ? "hide" : "show", stats.frames, legacy);
+            CHECK(stats.frames < legacy);
+        }
+    }
+}
+
+// 四个通道各用一种弹簧、起点与初速度同时推进，每一步都与逐通道的解析解比较。
+// 浮点 (SSE) 与定点内核都走这里：误差来自采样插值与定点量化，位置限制在 1 个渲染单位内，
+// 速度 (静止时刻之前) 限制在峰值速度的 1% 内
+void TestBankLanes() {
+    BakeSpringCurves();
+    struct Lane { const SpringParams* p; float from, to, vel, lo, hi; };
+    const Lane lanes[BANK_LANES] = {
+        { &SP_NORMAL, 0.0f, 1080.0f, 0.0f, -FLT_MAX, FLT_MAX },
+        { &SP_VERYSLOW, 1080.0f, -40.0f, -2000.0f, -FLT_MAX, FLT_MAX },
+        { &SP_FAST, 255.0f, 0.0f, 0.0f, 0.0f, 255.0f },
+        { &SP_SLOW, 40.0f, 255.0f, 900.0f, 0.0f, 255.0f }
+    };
+
+    SpringBank b;
+    memset(&b, 0, sizeof(b));
+    for (int i = 0; i < BANK_LANES; i++) {
+        SetLaneRange(b, i, lanes[i].lo, lanes[i].hi);
+        BankSet(b, i, lanes[i].from);
+        b.vel[i] = lanes[i].vel;
+        BankRetarget(b, i, lanes[i].to, *lanes[i].p);
+        CHECK(b.curve[i] != NULL);
+    }
+
+    double maxPosErr[BANK_LANES] = {}, maxVelErr[BANK_LANES] = {}, peakVel[BANK_LANES] = {};
+    for (int n = 0; n < 240 * 30; n++) {
+        BankStep(b, 1.0f / 240.0f);
+        for (int i = 0; i < BANK_LANES; i++) {
+            float x = lanes[i].from, v = lanes[i].vel;
+            SolveSpring(x, v, lanes[i].to, *lanes[i].p, b.elapsed[i]);
+            if (x < lanes[i].lo) x = lanes[i].lo;
+            if (x > lanes[i].hi) x = lanes[i].hi;
+            maxPosErr[i] = std::max(maxPosErr[i], (double)fabs(b.pos[i] - x));
+            peakVel[i] = std::max(peakVel[i], (double)fabs(v));
+            if (b.elapsed[i] < b.settleTime[i]) maxVelErr[i] = std::max(maxVelErr[i], (double)fabs(b.vel[i] - v));
+        }
+    }
+    for (int i = 0; i < BANK_LANES; i++) {
+        printf("  lane %d: pos %.3g, vel %.3g / %.0f\n", i, maxPosErr[i], maxVelErr[i], peakVel[i]);
+        CHECK(maxPosErr[i] < 1.0);
+        CHECK(maxVelErr[i] < peakVel[i] * 0.01);
+        CHECK(b.pos[i] == lanes[i].to);
+    }
+}
+
+// 同样的总时长以不同的分帧推进：每个检查点上弹簧组的状态与渲染值逐位一致
+struct ReplayState {
+    float pos[BANK_LANES];
+    float vel[BANK_LANES];
+    float render[BANK_LANES];
+};
+
+// 每个检查点间隔拆成 parts 帧 (parts 为 0 时随机拆成 1~8 帧)，记录各检查点的状态
+void ReplayTransition(const ConfigProfile& profile, bool hide, int parts, std::mt19937& rng, std::vector<ReplayState>& out) {
+    const int CHECKPOINT_US = 50000;
+    const int CHECKPOINTS = 60;
+    BenchResetTransition(profile, hide);
+    out.clear();
+    for (int k = 0; k < CHECKPOINTS; k++) {
+        int n = parts ? parts : 1 + (int)(rng() % 8);
+        int left = CHECKPOINT_US;
+        ReplayState s;
+        for (int j = 0; j < n; j++) {
+            int us = (j == n - 1) ? left : 1 + (int)(rng() % (left / (n - j)));
+            left -= us;
+            AdvancePhysics(us * 1e-6f, s.render);
+        }
+        for (int i = 0; i < BANK_LANES; i++) {
+            s.pos[i] = g_Render.bank.pos[i];
+            s.vel[i] = g_Render.bank.vel[i];
+        }
+        out.push_back(s);
+    }
+}
+
+void TestPhysicsReplay() {
+    BenchInit();
+    std::mt19937 rng(1);
+    std::vector<ReplayState> reference, replay;
+    for (int p = 0; p < PRESET_COUNT; p++) {
+        for (int hide = 0; hide < 2; hide++) {
+            ReplayTransition(PRESETS[p], hide != 0, 1, rng, reference);
+            const int parts[] = { 3, 7, 0, 0 };
+            for (int j = 0; j < (int)_countof(parts); j++) {
+                ReplayTransition(PRESETS[p], hide != 0, parts[j], rng, replay);
+                int mismatches = 0;
+                for (size_t k = 0; k < reference.size(); k++) {
+                    if (memcmp(&reference[k], &replay[k], sizeof(ReplayState)) != 0) mismatches++;
+                }
+                CHECK(mismatches == 0);
+            }
+        }
+    }
+}
+
+// /tune 在同一个配置对象上逐个替换候选参数：渲染侧须按内容而不是指针选择物理内核，两个通道都应找到参数
+// 搜索结果满足约束：静止时刻落在 [TUNE_MIN_DURATION, 1] 倍目标时长内，过冲不超过上限；
+// 以搜到的弹簧重新模拟一次，测得的静止时刻与结果一致 (相差不超过一个物理步)
+void CheckTuned(int lane, float durationMs, float overshootPct) {
+    TuneResult r;
+    CHECK(TuneChannel(lane, durationMs, overshootPct, r));
+    CHECK(r.settleMs >= durationMs * TUNE_MIN_DURATION && r.settleMs <= durationMs);
+    CHECK(r.overshootPct <= overshootPct);
+
+    ConfigProfile profile = { _T("tuned"), 0, 0, SP_OFF, SP_OFF, SP_OFF, SP_OFF };
+    if (lane == LANE_Y) profile.motionIn = profile.motionOut = r.spring;
+    else profile.opacityIn = profile.opacityOut = r.spring;
+    BakeSpringCurve(g_Curves[g_CurveCount++], r.spring);
+    BenchLaneStats stats[BENCH_LANES];
+    BenchTransition(profile, true, stats);
+    float step = ActivePhysicsStep() * 1000.0f;
+    g_CurveCount--;
+    CHECK_NEAR(stats[lane].settleTime * 1000.0f, r.settleMs, step);
+    CHECK(stats[lane].settleTime * 1000.0f >= durationMs * TUNE_MIN_DURATION - step);
+    CHECK(stats[lane].settleTime * 1000.0f <= durationMs + step);
+}
+
+void TestSpringTuner() {
+    BenchInit();
+    CheckTuned(LANE_Y, 450.0f, 3.0f);
+    CheckTuned(LANE_ALPHA, 450.0f, 3.0f);
+
+    // 同一地址上的配置从只有位置通道改为只有透明度通道，透明度通道照样推进
+    ConfigProfile profile = { _T("test"), 0, 0, SP_NORMAL, SP_NORMAL, SP_OFF, SP_OFF };
+    BenchTransition(profile, true, NULL);
+    profile.motionIn = profile.motionOut = SP_OFF;
+    profile.opacityIn = profile.opacityOut = SP_NORMAL;
+    BenchLaneStats stats[BENCH_LANES];
+    BenchTransition(profile, true, stats);
+    CHECK(stats[LANE_ALPHA].renderUpdates > 1);
+    CHECK(g_Render.bank.pos[LANE_ALPHA] == 0.0f);
+}
+
+// --- 逻辑状态机 (虚拟时钟) ---
+
+// 逻辑线程的命令经快照交给渲染侧后，在本线程中立即取回并按当前目标起段 (不推进时间)
+void SyncRender() {
+    PublishAnimSnapshot();
+    RenderSync();
+    StepPhysics(0.0f);
+}
+
+// 通道保持原位置与速度，并以新的弹簧起段
+void CheckContinuous(int lane, float pos, float vel, const SpringParams& spring) {
+    CHECK_NEAR(g_Render.bank.pos[lane], pos, 1e-3 * (1.0 + fabs(pos)));
+    CHECK_NEAR(g_Render.bank.vel[lane], vel, 1e-3 * (1.0 + fabs(vel)));
+    CHECK(g_Render.bank.spring[lane] == &spring);
+}
+
+void TestHotSwap() {
+    UseVirtualClock(true);
+    BenchInit();
+    g.cfgIndex = 4; // 滑动：位置与透明度都有动画
+    g.maskOptIndex = 0;
+    ApplySettings(NULL, true);
+
+    // 从完全显示开始隐藏，推进到半途
+    BenchResetTransition(*g.cfg, true);
+    float h = ActivePhysicsStep();
+    for (int i = 0; i < BENCH_MAX_STEPS && g_Render.bank.pos[LANE_Y] < g.screenH * 0.5f; i++) StepPhysics(h);
+    float y = g_Render.bank.pos[LANE_Y], vy = g_Render.bank.vel[LANE_Y];
+    float a = g_Render.bank.pos[LANE_ALPHA], va = g_Render.bank.vel[LANE_ALPHA];
+    CHECK(y > 1.0f && y < g.screenH - 1.0f && vy > 0.0f);
+
+    // 右键托盘图标：带着隐藏的动量转入显示，不跳到显示位置
+    PostLogicCommand(CMD_SHOW);
+    RunLogicCommands();
+    SyncRender();
+    CHECK(!g.isHidden);
+    CheckContinuous(LANE_Y, y, vy, g.cfg->motionIn);
+    CheckContinuous(LANE_ALPHA, a, va, g.cfg->opacityIn);
+
+    // 菜单打开期间动画继续，此时切换配置：以当前位置与速度接续新配置的弹簧
+    h = ActivePhysicsStep();
+    for (int i = 0; i < 10; i++) StepPhysics(h);
+    y = g_Render.bank.pos[LANE_Y]; vy = g_Render.bank.vel[LANE_Y];
+    a = g_Render.bank.pos[LANE_ALPHA]; va = g_Render.bank.vel[LANE_ALPHA];
+    CHECK(vy < 0.0f);
+    PostLogicCommand(CMD_SET_PROFILE, 5);
+    RunLogicCommands();
+    SyncRender();
+    CHECK(g.cfg == &PRESETS[5]);
+    CHECK(g.startupState == STARTUP_NORMAL);
+    CheckContinuous(LANE_Y, y, vy, PRESETS[5].motionIn);
+    CheckContinuous(LANE_ALPHA, a, va, PRESETS[5].opacityIn);
+
+    // 新配置禁用的通道直接到位
+    PostLogicCommand(CMD_SET_PROFILE, 0);
+    RunLogicCommands();
+    SyncRender();
+    CHECK(g_Render.bank.pos[LANE_Y] == 0.0f);
+    CHECK_NEAR(g_Render.bank.pos[LANE_ALPHA], a, 1e-3 * a);
+
+    h = ActivePhysicsStep();
+    for (int i = 0; i < BENCH_MAX_STEPS && !IsPhysicsIdle(); i++) StepPhysics(h);
+    CHECK(IsPhysicsIdle());
+    CHECK(g_Render.bank.pos[LANE_ALPHA] == 255.0f);
+
+    // 静止超过 hideDelayMs 后隐藏，时间全部来自虚拟时钟
+    ULONGLONG now = g_Clock->tickMs();
+    LogicTick(NULL, now + g.cfg->hideDelayMs, false);
+    CHECK(!g.isHidden);
+    LogicTick(NULL, now + g.cfg->hideDelayMs + 1, false);
+    CHECK(g.isHidden && g.targetAlpha == 0.0f);
+
+    // 启动流程中切换配置会结束启动流程，直接转入显示
+    g.startupState = STARTUP_PHASE_1_HIDING;
+    PostLogicCommand(CMD_SET_PROFILE, 4);
+    RunLogicCommands();
+    CHECK(g.startupState == STARTUP_NORMAL && !g.isHidden);
+    UseVirtualClock(false);
+}
+
+// 只有桌面上的鼠标移动推迟隐藏；隐藏后由原始输入唤醒，两次唤醒至少间隔 idleCheckMs
+void TestIdleWait() {
+    UseVirtualClock(true);
+    BenchInit();
+    ShimCreateDesktop(BENCH_SCREEN_W, BENCH_SCREEN_H);
+    LocateDesktop(NULL);
+    g.cfgIndex = 0;
+    g.cfg = &PRESETS[0];
+    g.startupState = STARTUP_NORMAL;
+    ULONGLONG now = 100000, check = g.cfg->idleCheckMs;
+
+    g.isHidden = true;
+    g.lastActiveTime = 0;
+    g_Shim.cursorWindow = NULL;
+    UpdateActivity(now, true); // 在其他窗口上移动
+    CHECK(g.isHidden && g.lastActiveTime == 0);
+    g_Shim.cursorWindow = g.hContainer;
+    UpdateActivity(now, true);
+    CHECK(!g.isHidden && g.lastActiveTime == now);
+    UpdateActivity(now + g.cfg->hideDelayMs + 1, false);
+    CHECK(g.isHidden);
+
+    bool raw = false;
+    g.rawInputWakeTime = 0;
+    CHECK(PlanIdleWait(now, false, &raw) == INFINITE && raw);
+    g.rawInputWakeTime = now; // 刚由原始输入唤醒
+    CHECK(PlanIdleWait(now + 10, false, &raw) == check - 10 && !raw);
+    CHECK(PlanIdleWait(now + check, false, &raw) == INFINITE && raw);
+    CHECK(PlanIdleWait(now + check, true, &raw) == check && !raw);
+
+    g.rawInputWakeTime = 0;
+    g_Shim.cursorWindow = NULL;
+    g.hContainer = NULL;
+    g.hDesktopParent = NULL;
+    UseVirtualClock(false);
+}
+
+// 带抖动的模拟显示器：第 k 次垂直同步位于 k·period 附近 (±period/8)，
+// 合成计时报告最近一次的实际时刻与名义周期。其余接口沿用虚拟时钟
+LONGLONG g_JitterPeriod = 0;
+std::vector<LONGLONG> g_JitterVBlanks;
+
+void JitterVSync() {
+    g_VirtualClock.vsyncs++;
+    g_VirtualClock.nowUs = *std::upper_bound(g_JitterVBlanks.begin(), g_JitterVBlanks.end(), g_VirtualClock.nowUs);
+}
+
+bool JitterVBlankTiming(LONGLONG* vblank, LONGLONG* period) {
+    *period = g_JitterPeriod;
+    *vblank = *(std::upper_bound(g_JitterVBlanks.begin(), g_JitterVBlanks.end(), g_VirtualClock.nowUs) - 1);
+    return true;
+}
+
+const Clock JITTER_CLOCK = { VirtualTickMs, VirtualCounter, VirtualFrequency, VirtualWait, VirtualWaitUntil, JitterVSync, JitterVBlankTiming };
+
+void UseJitterDisplay(int refreshHz, std::mt19937& rng) {
+    UseVirtualClock(true);
+    g_Clock = &JITTER_CLOCK;
+    g_JitterPeriod = 1000000 / refreshHz;
+    g_JitterVBlanks.clear();
+    for (int k = 0; k < 4000; k++) {
+        int jitter = (int)(rng() % (g_JitterPeriod / 4 + 1)) - (int)(g_JitterPeriod / 8);
+        g_JitterVBlanks.push_back(k * g_JitterPeriod + jitter);
+    }
+    g_VirtualClock.nowUs = g_JitterPeriod;
+    g_Render.pacer.fixedRate = true; // 只看帧调度，不做尾段降频
+}
+
+// 一段连续帧的调度结果：准时帧与上一帧目标的间隔 (周期数) 范围，迟到帧及其后一帧跳过的垂直同步数
+struct PaceStats {
+    int minGap, maxGap;
+    int onTimeGaps, onTimeFrames;
+    int lateFrames, skipped;
+};
+
+// 以 capIndex 帧率上限连续规划 frames 帧：准时帧的工作耗时不足四分之一周期，
+// 每 lateEvery 帧中有一帧超过一个周期。每帧检查预测的目标与实际等到的垂直同步。
+// 迟到帧开始规划时可能恰在抖动窗口内，它与外推时刻的先后不确定，跳过的那一次可能记在后一帧上
+PaceStats PaceFrames(int capIndex, int frames, int lateEvery, std::mt19937& rng) {
+    FramePacer& fp = g_Render.pacer;
+    const LONGLONG P = g_JitterPeriod;
+    PaceStats st = { 1 << 30, 0, 0, 0, 0, 0 };
+    g_Render.view.frameCapIndex = capIndex;
+    EndFramePacing();
+    LONGLONG prevTarget = 0;
+    bool wasLate = false;
+    for (int f = 0; f < frames; f++) {
+        bool late = (lateEvery > 0 && f % lateEvery == lateEvery - 1);
+        g_VirtualClock.nowUs += late ? P + 1 + (LONGLONG)(rng() % P) : (LONGLONG)(rng() % (P / 4));
+        LONGLONG now = g_VirtualClock.nowUs;
+
+        LONGLONG present = PlanFrame();
+        CHECK(fp.period == P);
+        CHECK(present == fp.target + fp.period);
+        // 目标是按周期外推的垂直同步，严格晚于当前时刻：迟到的帧不瞄准已经过去的垂直同步
+        CHECK(fp.target > now);
+        CHECK((fp.target - fp.vblank) % P == 0);
+        if (capIndex == 0) CHECK(fp.target - now <= P + P / 4);
+
+        if (prevTarget) {
+            int gap = (int)((fp.target - prevTarget) / P);
+            if (late || wasLate) {
+                if (late) st.lateFrames++;
+                st.skipped += gap - 1;
+            }
+            else {
+                st.minGap = std::min(st.minGap, gap);
+                st.maxGap = std::max(st.maxGap, gap);
+                st.onTimeGaps += gap;
+                st.onTimeFrames++;
+            }
+        }
+        prevTarget = fp.target;
+        wasLate = late;
+
+        // 参考与实际垂直同步各有至多 P/8 的抖动：准时帧等到的就是目标附近的那一次
+        WaitForFrame();
+        LONGLONG landed = g_VirtualClock.nowUs;
+        CHECK(landed >= fp.target - (late ? P : 0) - P / 4);
+        CHECK(landed <= fp.target + (late ? P : 0) + P / 4);
+    }
+    return st;
+}
+
+void TestFramePacing() {
+    // 外推：严格晚于 now 的第一个垂直同步
+    CHECK(PredictNextVBlank(1000, 0, 0) == 1000);
+    CHECK(PredictNextVBlank(1000, 5000, 100) == 5000);
+    CHECK(PredictNextVBlank(1000, 1000, 100) == 1100);
+    CHECK(PredictNextVBlank(1050, 1000, 100) == 1100);
+    CHECK(PredictNextVBlank(1399, 1000, 100) == 1400);
+
+    std::mt19937 rng(7);
+
+    // 不设上限：准时帧逐个瞄准下一次垂直同步；迟到帧跳过错过的那几次，之后不补帧
+    UseJitterDisplay(60, rng);
+    PaceStats st = PaceFrames(0, 300, 0, rng);
+    CHECK(st.minGap == 1 && st.maxGap == 1);
+    st = PaceFrames(0, 300, 10, rng);
+    CHECK(st.lateFrames == 30);
+    CHECK(st.skipped >= st.lateFrames);
+    CHECK(st.minGap == 1 && st.maxGap == 1);
+
+    // 60 Hz 下 30 FPS：每两个周期一帧；迟到后从该帧重新计时，随后的准时帧仍隔两个周期
+    UseJitterDisplay(60, rng);
+    st = PaceFrames(1, 300, 0, rng);
+    CHECK(st.minGap == 2 && st.maxGap == 2);
+    st = PaceFrames(1, 300, 10, rng);
+    CHECK(st.lateFrames == 30);
+    CHECK(st.minGap == 2 && st.maxGap == 2);
+
+    // 144 Hz 下 60 FPS：非整数倍，间隔在 2 与 3 个周期之间交替，平均帧率仍为 60
+    UseJitterDisplay(144, rng);
+    st = PaceFrames(2, 600, 0, rng);
+    CHECK(st.minGap == 2 && st.maxGap == 3);
+    CHECK_NEAR(st.onTimeFrames / (st.onTimeGaps * g_JitterPeriod * 1e-6), 60.0, 0.5);
+
+    EndFramePacing();
+    g_Render.view.frameCapIndex = 0;
+    g_Render.pacer.fixedRate = false;
+    UseVirtualClock(false);
+}
+
+// 动画中途热切换时遮罩不复位：渲染侧接续当前的透明度，不出现透明度为 0 或挂接时的整窗调整
+HWND g_RecordMask = NULL;
+int g_MaskAlphaZero = 0;
+int g_MaskAlphaCalls = 0;
+int g_MaskFrameChanged = 0;
+
+void RecordMaskLayered(HWND hwnd, BYTE alpha) {
+    if (hwnd != g_RecordMask) return;
+    g_MaskAlphaCalls++;
+    if (alpha == 0) g_MaskAlphaZero++;
+}
+
+void RecordMaskPos(HWND hwnd, int x, int y, int cx, int cy, UINT flags) {
+    if (hwnd == g_RecordMask && (flags & SWP_FRAMECHANGED)) g_MaskFrameChanged++;
+}
+
+// 渲染线程的一帧：推进物理并提交窗口
+void StepAndApply(int steps) {
+    for (int i = 0; i < steps; i++) {
+        StepPhysics(ActivePhysicsStep());
+        ApplyAnimation(g_Render.bank.pos[LANE_Y], g_Render.bank.pos[LANE_ALPHA], g_Render.bank.pos[LANE_MASK]);
+    }
+}
+
+void TestHotSwapMask() {
+    UseVirtualClock(true);
+    BenchInit();
+    ShimCreateDesktop(BENCH_SCREEN_W, BENCH_SCREEN_H);
+    LocateDesktop(NULL);
+    CHECK(g.hContainer && g.screenH == BENCH_SCREEN_H);
+    g.cfgIndex = 4;
+    g.maskOptIndex = 2;
+    ApplySettings(NULL, true);
+    HWND mask = g.hMaskWindow;
+    CHECK(mask && IsWindowVisible(mask));
+
+    // 从完全显示开始隐藏，推进到半途
+    BenchResetTransition(*g.cfg, true);
+    StepAndApply(1);
+    for (int i = 0; i < BENCH_MAX_STEPS && g_Render.bank.pos[LANE_Y] < g.screenH * 0.5f; i++) StepAndApply(1);
+    CHECK(g_Render.bank.pos[LANE_MASK] > 1.0f);
+
+    g_RecordMask = mask;
+    g_Shim.onSetLayered = RecordMaskLayered;
+    g_Shim.onSetWindowPos = RecordMaskPos;
+    PostLogicCommand(CMD_SET_PROFILE, 5);
+    RunLogicCommands();
+    SyncRender();
+    StepAndApply(10);
+    PostLogicCommand(CMD_SET_MASK, 3);
+    RunLogicCommands();
+    SyncRender();
+    StepAndApply(10);
+    CHECK(g.hMaskWindow == mask);
+    CHECK(g_MaskAlphaCalls > 0); // 重新同步后提交过遮罩透明度
+    CHECK(g_MaskAlphaZero == 0);
+    CHECK(g_MaskFrameChanged == 0);
+
+    // 重新定位桌面后遮罩被隐藏，启动流程重新挂接
+    LocateDesktop(NULL);
+    CHECK(!IsWindowVisible(mask));
+    g.startupState = STARTUP_PHASE_2_WAITING;
+    g.waitStartTime = 0;
+    LogicTick(NULL, STARTUP_TRANSITION_DELAY + 1, false);
+    CHECK(IsWindowVisible(mask));
+    CHECK(g_MaskFrameChanged == 1);
+    CHECK(g_Shim.deadHandleCalls.load() == 0);
+
+    g_Shim.onSetLayered = NULL;
+    g_Shim.onSetWindowPos = NULL;
+    g.maskOptIndex = 0;
+    ApplySettings(NULL, false);
+    CHECK(!g.hMaskWindow && !IsWindow(mask));
+    g.hContainer = NULL;
+    g.hDesktopParent = NULL;
+    UseVirtualClock(false);
+}
+
+// --- 线程间的数据结构 ---
+
+struct TestPayload {
+    unsigned seq;
+    unsigned check[15]; // check[i] = seq * (i + 1)，读到写了一半的数据时对不上
+};
+
+void TestTripleBufferBasic() {
+    TripleBuffer<int> tb;
+    CHECK(!tb.Consume());
+    tb.Write() = 1;
+    tb.Publish();
+    tb.Write() = 2;
+    tb.Publish();
+    CHECK(tb.Consume());
+    CHECK(tb.Read() == 2); // 未取走的旧版本被覆盖
+    CHECK(!tb.Consume());
+    CHECK(tb.Read() == 2);
+    tb.Write() = 3;
+    tb.Publish();
+    CHECK(tb.Read() == 2); // 下一次 Consume 之前保持不变
+    CHECK(tb.Consume() && tb.Read() == 3);
+}
+
+void TestTripleBufferThreads() {
+    const unsigned LAST = 200000;
+    static TripleBuffer<TestPayload> tb;
+    std::thread producer([] {
+        for (unsigned s = 1; s <= LAST; s++) {
+            TestPayload& p = tb.Write();
+            p.seq = s;
+            for (int i = 0; i < 15; i++) p.check[i] = s * (i + 1);
+            tb.Publish();
+        }
+    });
+
+    unsigned last = 0, torn = 0, backwards = 0, reads = 0;
+    while (last != LAST) {
+        if (!tb.Consume()) { std::this_thread::yield(); continue; }
+        const TestPayload& p = tb.Read();
+        for (int i = 0; i < 15; i++) if (p.check[i] != p.seq * (i + 1)) torn++;
+        if (p.seq <= last) backwards++;
+        last = p.seq;
+        reads++;
+    }
+    producer.join();
+    CHECK(torn == 0);
+    CHECK(backwards == 0);
+    CHECK(reads > 0);
+}
+
+void TestCommandQueueBasic() {
+    CommandQueue<int, 8> q;
+    int v = 0;
+    CHECK(!q.Pop(v));
+    for (int i = 0; i < 8; i++) CHECK(q.Push(i));
+    CHECK(!q.Push(8)); // 满时不阻塞
+    for (int i = 0; i < 8; i++) CHECK(q.Pop(v) && v == i);
+    CHECK(!q.Pop(v));
+    for (int i = 0; i < 20; i++) { CHECK(q.Push(i)); CHECK(q.Pop(v) && v == i); } // 序号回绕
+}
+
+void TestCommandQueueThreads() {
+    const int PRODUCERS = 4;
+    const int PER_PRODUCER = 50000;
+    static CommandQueue<LogicCommand, LOGIC_QUEUE_SIZE> q;
+    std::vector<std::thread> producers;
+    for (int k = 0; k < PRODUCERS; k++) {
+        producers.push_back(std::thread([k] {
+            for (int i = 0; i < PER_PRODUCER; i++) {
+                LogicCommand c = { k, i };
+                while (!q.Push(c)) std::this_thread::yield();
+            }
+        }));
+    }
+
+    int next[PRODUCERS] = { 0 };
+    int received = 0, outOfOrder = 0;
+    while (received < PRODUCERS * PER_PRODUCER) {
+        LogicCommand c;
+        if (!q.Pop(c)) { std::this_thread::yield(); continue; }
+        if (c.type < 0 || c.type >= PRODUCERS || c.arg != next[c.type]) outOfOrder++;
+        else next[c.type]++;
+        received++;
+    }
+    for (size_t k = 0; k < producers.size(); k++) producers[k].join();
+    LogicCommand c;
+    CHECK(!q.Pop(c));
+    CHECK(outOfOrder == 0);
+    for (int k = 0; k < PRODUCERS; k++) CHECK(next[k] == PER_PRODUCER);
+}
+
+// 逻辑线程来不及处理时命令不丢弃：同类命令合并为最新的一条，且不越过仍在队列中的同类命令
+void TestLogicCommandOverflow() {
+    g.frameCapIndex = 0;
+    g_Flags.isPaused = false;
+    DWORD saveSeq = g.flightSaveSeq;
+    for (int i = 1; i <= LOGIC_QUEUE_SIZE + 10; i++) PostLogicCommand(CMD_SET_FRAME_CAP, i % FRAME_CAP_COUNT);
+    PostLogicCommand(CMD_SET_PAUSED, 1);
+    PostLogicCommand(CMD_SAVE_FRAME_LOG);
+    PostLogicCommand(CMD_SET_PAUSED, 0);
+    PostLogicCommand(CMD_SET_PAUSED, 1);
+    RunLogicCommands();
+    CHECK(g.frameCapIndex == (LOGIC_QUEUE_SIZE + 10) % FRAME_CAP_COUNT);
+    CHECK(g_Flags.isPaused);
+    CHECK(g.flightSaveSeq == saveSeq + 1);
+    LogicCommand c;
+    CHECK(!g_Commands.Pop(c));
+    for (int i = 0; i < CMD_COUNT; i++) CHECK(!g_CommandOverflow[i].set.load());
+
+    // 多个线程同时提交，逻辑线程边提交边执行
+    static std::atomic<int> done(0);
+    std::vector<std::thread> producers;
+    for (int k = 0; k < 4; k++) {
+        producers.push_back(std::thread([k] {
+            for (int i = 0; i < 20000; i++) PostLogicCommand(CMD_SET_FRAME_CAP, (i + k) % FRAME_CAP_COUNT);
+            PostLogicCommand(CMD_SET_PAUSED, 0);
+            done++;
+        }));
+    }
+    while (done.load() < 4) RunLogicCommands();
+    for (size_t k = 0; k < producers.size(); k++) producers[k].join();
+    RunLogicCommands();
+    CHECK(!g_Flags.isPaused);
+    CHECK(g.frameCapIndex >= 0 && g.frameCapIndex < FRAME_CAP_COUNT);
+    CHECK(!g_Commands.Pop(c));
+    for (int i = 0; i < CMD_COUNT; i++) CHECK(!g_CommandOverflow[i].set.load());
+}
+
+std::atomic<int> g_TaskStarted(0);
+std::atomic<int> g_TaskFinished(0);
+std::atomic<int> g_TaskRunningLow(0);
+std::atomic<int> g_TaskMaxRunningLow(0);
+std::atomic<bool> g_TaskRelease(false);
+
+void SlowTask(int sleepMs, int unused) {
+    g_TaskStarted++;
+    std::this_thread::sleep_for(std::chrono::milliseconds(sleepMs));
+    g_TaskFinished++;
+}
+
+// 阻塞直到放行，记录同时执行的低优先级任务数
+void BlockingLowTask(int unused0, int unused1) {
+    int n = ++g_TaskRunningLow;
+    int seen = g_TaskMaxRunningLow.load();
+    while (n > seen && !g_TaskMaxRunningLow.compare_exchange_weak(seen, n)) {}
+    while (!g_TaskRelease.load()) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    g_TaskRunningLow--;
+    g_TaskFinished++;
+}
+
+void TestTaskPool() {
+    // Stop 等正在执行的任务结束后才返回，未到期的任务被丢弃
+    {
+        TaskPool pool;
+        CHECK(!pool.Submit(SlowTask, 0, 0, TASK_PRIORITY_HIGH, 0)); // 未启动
+        CHECK(pool.Start());
+        g_TaskStarted = 0;
+        g_TaskFinished = 0;
+        CHECK(pool.Submit(SlowTask, 100, 0, TASK_PRIORITY_HIGH, 0));
+        CHECK(pool.Submit(SlowTask, 0, 0, TASK_PRIORITY_HIGH, 60000));
+        while (g_TaskStarted.load() == 0) std::this_thread::yield();
+        pool.Stop();
+        CHECK(g_TaskStarted.load() == 1);
+        CHECK(g_TaskFinished.load() == 1);
+        CHECK(!pool.Submit(SlowTask, 0, 0, TASK_PRIORITY_HIGH, 0)); // 已退出
+    }
+
+    // 低优先级任务最多占用 TASK_POOL_THREADS - 1 个线程，高优先级任务不被它们挡住
+    {
+        TaskPool pool;
+        CHECK(pool.Start());
+        g_TaskStarted = 0;
+        g_TaskFinished = 0;
+        g_TaskMaxRunningLow = 0;
+        g_TaskRelease = false;
+        for (int i = 0; i < TASK_POOL_THREADS + 1; i++) CHECK(pool.Submit(BlockingLowTask, 0, 0, TASK_PRIORITY_LOW, 0));
+        CHECK(pool.Submit(SlowTask, 0, 0, TASK_PRIORITY_HIGH, 0));
+        while (g_TaskStarted.load() == 0 || g_TaskRunningLow.load() < TASK_POOL_THREADS - 1) std::this_thread::yield();
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        CHECK(g_TaskMaxRunningLow.load() == TASK_POOL_THREADS - 1);
+        CHECK(pool.Cancel(BlockingLowTask) == 2); // 其余两个仍在排队
+        g_TaskRelease = true;
+        pool.Stop();
+        CHECK(g_TaskFinished.load() == TASK_POOL_THREADS);
+    }
+}
+
+// 线程数超过 PERF_MAX_THREADS 时，多出的线程共用最后一块，汇总不丢计数
+void TestPerfCounters() {
+    LONGLONG before[PC_COUNT];
+    PerfCollect(before);
+    const int THREADS = PERF_MAX_THREADS + 4;
+    const int PER_THREAD = 10000;
+    std::vector<std::thread> threads;
+    for (int k = 0; k < THREADS; k++) {
+        threads.push_back(std::thread([] {
+            PerfNameThread(_T("test"));
+            for (int i = 0; i < PER_THREAD; i++) PerfCount(PC_HTTP_REQUEST);
+        }));
+    }
+    for (size_t k = 0; k < threads.size(); k++) threads[k].join();
+    LONGLONG after[PC_COUNT];
+    PerfCollect(after);
+    CHECK(after[PC_HTTP_REQUEST] - before[PC_HTTP_REQUEST] == (LONGLONG)THREADS * PER_THREAD);
+    CHECK(g_PerfBlockCount.load() > PERF_MAX_THREADS);
+}
+
+// 销毁遮罩窗口前，渲染线程已取走不含该句柄的快照
+void TestRenderHandshake() {
+    g.cfg = &PRESETS[0];
+    g.hContainer = NULL;
+    g.hMaskWindow = (HWND)0x1234;
+    g.renderQuit = false;
+    g_Render.flightSaveSeq = g.flightSaveSeq; // 前面的测试请求过保存帧记录，不让渲染线程写出文件
+    CHECK(StartRenderThread());
+    for (int i = 0; i < 100; i++) {
+        g.targetY = (float)(i % 2) * g.screenH;
+        PublishAnimSnapshot();
+        g.hMaskWindow = (HWND)(intptr_t)(0x1234 + i * 4);
+        DestroyMaskWindow();
+        CHECK(g.hMaskWindow == NULL);
+        CHECK(LatestRenderStatus().seq == g.published.seq);
+    }
+    StopRenderThread();
+    g.renderQuit = false;
+    g.targetY = 0.0f;
+}
+
+// --- 帧记录 ---
+
+// 第 n 帧的记录，各字段取不同的值以便发现错位
+FlightFrame MakeFlightFrame(DWORD n) {
+    FlightFrame f;
+    f.frame = n;
+    f.intervalUs = 1000000 + n;
+    f.dtUs = 2000000 + n;
+    f.applyUs = 3000000 + n;
+    f.physicsUs = 4000000 + n;
+    f.waitUs = 5000000 + n;
+    f.lateUs = -(LONG)n * 7;
+    f.setWindowPos = (BYTE)n;
+    f.setLayered = (BYTE)(n * 3);
+    f.enforceZOrder = (BYTE)(n * 5);
+    f.timerWaits = (BYTE)(n * 7);
+    return f;
+}
+
+// main.cpp 写出的文件由 Tools/FlightAnalyzer.cpp 的解码器读回：两边的字段偏移一致，
+// 文件头与每一帧的取值一致；环形缓冲已回绕时按从旧到新的顺序写出
+void TestFlightFile() {
+    CHECK(sizeof(FlightFileHeader) == HEADER_SIZE);
+    CHECK(sizeof(FlightFrame) == FRAME_SIZE);
+    CHECK(offsetof(FlightFileHeader, version) == 4 && offsetof(FlightFileHeader, frameSize) == 6);
+    CHECK(offsetof(FlightFileHeader, count) == 8 && offsetof(FlightFileHeader, periodUs) == 12);
+    CHECK(offsetof(FlightFileHeader, reason) == 16 && offsetof(FlightFileHeader, profile) == 20);
+    CHECK(offsetof(FlightFileHeader, capFps) == 24 && offsetof(FlightFileHeader, hitchMs) == 28);
+    CHECK(offsetof(FlightFrame, intervalUs) == 4 && offsetof(FlightFrame, dtUs) == 8);
+    CHECK(offsetof(FlightFrame, applyUs) == 12 && offsetof(FlightFrame, physicsUs) == 16);
+    CHECK(offsetof(FlightFrame, waitUs) == 20 && offsetof(FlightFrame, lateUs) == 24);
+    CHECK(offsetof(FlightFrame, setWindowPos) == 28 && offsetof(FlightFrame, setLayered) == 29);
+    CHECK(offsetof(FlightFrame, enforceZOrder) == 30 && offsetof(FlightFrame, timerWaits) == 31);
+
+    UseVirtualClock(true);
+    const DWORD total = FLIGHT_FRAMES + 5;
+    for (DWORD n = 0; n < total; n++) g_Flight.frames[n % FLIGHT_FRAMES] = MakeFlightFrame(n);
+    g_Flight.count = total;
+    g_Render.pacer.period = 6944; // 144 Hz
+    g_Render.view.cfg = &PRESETS[3];
+    g_Render.view.frameCapIndex = 2;
+    CHECK(FlightSave(FLIGHT_REASON_HITCH));
+
+    TCHAR szPath[MAX_PATH];
+    char path[MAX_PATH];
+    FlightRecordPath(szPath, _countof(szPath));
+    wcstombs(path, szPath, sizeof(path));
+    FlightAnalyzer::Header h;
+    std::vector<FlightAnalyzer::Frame> frames;
+    CHECK(FlightAnalyzer::ReadFlightFile(path, h, frames));
+    CHECK(h.magic == FLIGHT_MAGIC && h.version == FLIGHT_VERSION && h.frameSize == sizeof(FlightFrame));
+    CHECK(h.count == FLIGHT_FRAMES && frames.size() == FLIGHT_FRAMES);
+    CHECK(h.periodUs == 6944 && h.reason == FLIGHT_REASON_HITCH && h.profile == 3);
+    CHECK(h.capFps == (DWORD)FRAME_CAP_OPTIONS[2] && h.hitchMs == FLIGHT_HITCH_MS);
+
+    int mismatches = 0;
+    for (size_t i = 0; i < frames.size(); i++) {
+        const FlightAnalyzer::Frame& a = frames[i];
+        FlightFrame e = MakeFlightFrame((DWORD)(total - FLIGHT_FRAMES + i));
+        if (a.frame != e.frame || a.intervalUs != e.intervalUs || a.dtUs != e.dtUs || a.applyUs != e.applyUs ||
+            a.physicsUs != e.physicsUs || a.waitUs != e.waitUs || a.lateUs != e.lateUs ||
+            a.setWindowPos != e.setWindowPos || a.setLayered != e.setLayered ||
+            a.enforceZOrder != e.enforceZOrder || a.timerWaits != e.timerWaits) mismatches++;
+    }
+    CHECK(mismatches == 0);
+
+    remove(path);
+    memset(&g_Flight, 0, sizeof(g_Flight));
+    g_Render.pacer.period = 0;
+    g_Render.view.cfg = NULL;
+    g_Render.view.frameCapIndex = 0;
+    UseVirtualClock(false);
+}
+
+// --- 压力测试 ---
+
+// 几个线程随机提交菜单命令与显示变化，逻辑线程按主循环的顺序推进，渲染线程同时运行。
+// 检查渲染线程不对已销毁的遮罩调用 Win32、命令全部执行完、渲染线程取到最后的快照，并输出各把锁的持有时长。
+// 随机种子取自环境变量 STRESS_SEED (缺省按时间)，失败时按输出的种子重现
+const int STRESS_PRODUCERS = 3;
+const int STRESS_ITERATIONS = 2000;
+
+std::atomic<bool> g_StressStop(false);
+
+void StressProducer(unsigned seed) {
+    std::mt19937 rng(seed);
+    PerfNameThread(_T("stress"));
+    while (!g_StressStop.load()) {
+        switch (rng() % 6) {
+        case 0: PostLogicCommand(CMD_SET_PROFILE, (int)(rng() % PRESET_COUNT)); break;
+        case 1: PostLogicCommand(CMD_SET_MASK, (int)(rng() % MASK_OPT_COUNT)); break;
+        case 2: PostLogicCommand(CMD_SET_FRAME_CAP, (int)(rng() % FRAME_CAP_COUNT)); break;
+        case 3: PostLogicCommand(CMD_SHOW); break;
+        case 4: PostLogicCommand(CMD_SAVE_FRAME_LOG); break;
+        default: g_Tasks.Submit(DisplayResetTask, 0, 0, TASK_PRIORITY_HIGH, rng() % 5); break; // 同延迟到期的显示变化
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(rng() % 2000));
+    }
+}
+
+void PrintLockStats(const char* name, const StatMutex& m) {
+    long long holds = m.holds.load();
+    printf("  %-16s %8lld holds  mean %8.2f us  max %9.2f us\n", name, holds,
+        holds ? m.totalNs.load() / 1000.0 / holds : 0.0, m.maxNs.load() / 1000.0);
+}
+
+void TestStress() {
+    const char* env = getenv("STRESS_SEED");
+    unsigned seed = env ? (unsigned)strtoul(env, NULL, 10) : (unsigned)time(NULL);
+    printf("  seed %u\n", seed);
+    std::mt19937 rng(seed);
+
+    UseVirtualClock(false);
+    BenchInit();
+    ShimCreateDesktop(BENCH_SCREEN_W, BENCH_SCREEN_H);
+    g_Shim.deadHandleCalls = 0;
+    g.cfgIndex = 4;
+    g.maskOptIndex = 2;
+    g.frameCapIndex = 0;
+    g_Flags.isPaused = false;
+    g.renderQuit = false;
+    LocateDesktop(NULL);
+    ApplySettings(NULL, true);
+    CHECK(g_Tasks.Start());
+    CHECK(StartRenderThread());
+    g_StressStop = false;
+    std::vector<std::thread> producers;
+    for (int k = 0; k < STRESS_PRODUCERS; k++) producers.push_back(std::thread(StressProducer, seed + 1 + k));
+
+    // 逻辑线程：主循环的一次迭代 (不含消息泵与等待)，穿插分辨率变化、更新检测与鼠标移动
+    int relocations = 0;
+    for (int i = 0; i < STRESS_ITERATIONS; i++) {
+        RunLogicCommands();
+        if (!IsWindow(g.hContainer)) {
+            LocateDesktop(NULL);
+            relocations++;
+        }
+        if (rng() % 200 == 0) {
+            g_Shim.screenW = 1280 + (int)(rng() % 1280);
+            g_Shim.screenH = 720 + (int)(rng() % 720);
+            MsgWndProc(NULL, WM_DISPLAYCHANGE, 0, 0);
+        }
+        if (rng() % 500 == 0) StartUpdateChecks();
+        g_Shim.cursorWindow = (rng() % 3 == 0) ? g.hContainer : NULL;
+        LogicTick(NULL, g_Clock->tickMs(), rng() % 4 == 0);
+        PublishAnimSnapshot();
+        std::this_thread::sleep_for(std::chrono::microseconds(rng() % 1000));
+    }
+
+    g_StressStop = true;
+    for (size_t k = 0; k < producers.size(); k++) producers[k].join();
+    CancelUpdateChecks();
+    g_Tasks.Stop();
+    RunLogicCommands();
+    PublishAnimSnapshot();
+    WaitRenderSnapshotConsumed();
+    CHECK(LatestRenderStatus().seq == g.published.seq);
+    StopRenderThread();
+    g.renderQuit = false;
+
+    LogicCommand c;
+    CHECK(!g_Commands.Pop(c));
+    for (int i = 0; i < CMD_COUNT; i++) CHECK(!g_CommandOverflow[i].set.load());
+    CHECK(relocations > 0);
+    CHECK(g_Shim.deadHandleCalls.load() == 0);
+    g_Shim.cursorWindow = NULL;
+
+    printf("  %d desktop relocations\n", relocations);
+    PrintLockStats("WakeSignal", g_Render.wake.m);
+    PrintLockStats("TaskPool", g_Tasks.m);
+    PrintLockStats("UpdateContext", g_UpdateCtx.lock);
+}
+
+// --- 基准 ---
+
+typedef std::chrono::steady_clock BenchClock;
+
+double MicrosecondsSince(BenchClock::time_point since) {
+    return std::chrono::duration<double, std::micro>(BenchClock::now() - since).count();
+}
+
+// 最近秩法取分位数 (同 Tools/FlightAnalyzer.cpp)，values 须已排序
+double Percentile(const std::vector<double>& values, double p) {
+    if (values.empty()) return 0.0;
+    size_t rank = (size_t)(p / 100.0 * values.size() + 0.999999);
+    if (rank < 1) rank = 1;
+    if (rank > values.size()) rank = values.size();
+    return values[rank - 1];
+}
+
+void PrintLatency(const char* name, std::vector<double> us) {
+    std::sort(us.begin(), us.end());
+    printf("  %-22s p50 %9.1f  p99 %9.1f  p99.9 %9.1f  max %9.1f us\n", name,
+        Percentile(us, 50), Percentile(us, 99), Percentile(us, 99.9), us.empty() ? 0.0 : us.back());
+}
+
+const int CHURN_JOBS = 2000;
+BenchClock::time_point g_ChurnSubmit[CHURN_JOBS];
+double g_ChurnLatencyUs[CHURN_JOBS];
+std::atomic<int> g_ChurnDone(0);
+
+void ChurnTask(int job, int unused) {
+    g_ChurnLatencyUs[job] = MicrosecondsSince(g_ChurnSubmit[job]);
+    g_ChurnDone++;
+}
+
+// 后台任务从提交到开始执行的延迟：常驻线程池对比每个任务新建一个线程 (改用线程池之前的做法)。
+// 按更新检测的方式成批提交，每批 _countof(MIRRORS) 个，批间隔 500us
+void BenchTaskPoolLatency() {
+    const int BATCH = (int)_countof(MIRRORS);
+    for (int mode = 0; mode < 2; mode++) {
+        TaskPool pool;
+        std::vector<std::thread> threads;
+        if (mode == 0) pool.Start();
+        g_ChurnDone = 0;
+        BenchClock::time_point begin = BenchClock::now();
+        for (int job = 0; job < CHURN_JOBS; job++) {
+            g_ChurnSubmit[job] = BenchClock::now();
+            if (mode == 0) {
+                while (!pool.Submit(ChurnTask, job, 0, TASK_PRIORITY_HIGH, 0)) std::this_thread::yield();
+            }
+            else {
+                threads.push_back(std::thread(ChurnTask, job, 0));
+            }
+            if ((job + 1) % BATCH == 0) std::this_thread::sleep_for(std::chrono::microseconds(500));
+        }
+        while (g_ChurnDone.load() < CHURN_JOBS) std::this_thread::yield();
+        double totalMs = MicrosecondsSince(begin) / 1000.0;
+        for (size_t k = 0; k < threads.size(); k++) threads[k].join();
+        pool.Stop();
+
+        PrintLatency(mode == 0 ? "pool submit->start" : "thread-per-task", std::vector<double>(g_ChurnLatencyUs, g_ChurnLatencyUs + CHURN_JOBS));
+        printf("  %-22s %d jobs, %d threads created, %.1f ms\n", "", CHURN_JOBS, mode == 0 ? TASK_POOL_THREADS : CHURN_JOBS, totalMs);
+    }
+}
+
+// 伪共享：同样的访问模式分别在按缓存行对齐与紧凑排列的布局上运行，输出每次操作的耗时。
+// 只有一个核时各线程轮流执行，两种布局不会有差别
+
+// 与 PerfCounterBlock 成员相同，去掉按缓存行对齐
+struct PackedPerfBlock {
+    std::atomic<LONG> counts[PC_COUNT];
+    std::atomic<const TCHAR*> thread;
+};
+
+// 每个线程只写自己的计数块，访问方式同 PerfCount
+template <typename Block>
+double CounterBlockNs(int threads, int iterations) {
+    static Block blocks[PERF_MAX_THREADS];
+    std::atomic<bool> go(false);
+    std::vector<std::thread> workers;
+    for (int k = 0; k < threads; k++) {
+        workers.push_back(std::thread([&go, k, iterations] {
+            Block& b = blocks[k];
+            while (!go.load()) std::this_thread::yield();
+            for (int i = 0; i < iterations; i++) {
+                int id = i % PC_COUNT;
+                b.counts[id].store(b.counts[id].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            }
+        }));
+    }
+    BenchClock::time_point begin = BenchClock::now();
+    go = true;
+    for (size_t k = 0; k < workers.size(); k++) workers[k].join();
+    return MicrosecondsSince(begin) * 1000.0 / ((double)threads * iterations);
+}
+
+// 生产者连续发布，消费者忙等取走，与快照、渲染状态的交接方式相同
+template <size_t ALIGN>
+double TripleBufferNs(unsigned publishes) {
+    static TripleBuffer<TestPayload, ALIGN> tb;
+    std::atomic<bool> done(false);
+    BenchClock::time_point begin = BenchClock::now();
+    std::thread consumer([&done] {
+        unsigned sum = 0;
+        while (!done.load(std::memory_order_relaxed)) {
+            if (tb.Consume()) sum += tb.Read().seq;
+        }
+        (void)sum;
+    });
+    for (unsigned s = 1; s <= publishes; s++) {
+        TestPayload& p = tb.Write();
+        p.seq = s;
+        for (int i = 0; i < 15; i++) p.check[i] = s * (i + 1);
+        tb.Publish();
+    }
+    double ns = MicrosecondsSince(begin) * 1000.0 / publishes;
+    done = true;
+    consumer.join();
+    return ns;
+}
+
+// 单次计数的开销：本线程独占的计数块 (PerfCount)，对比超出 PERF_MAX_THREADS 后共用块上的原子自增
+void BenchPerfCountOverhead() {
+    const int ITERATIONS = 10000000;
+    PerfNameThread(_T("bench"));
+    BenchClock::time_point begin = BenchClock::now();
+    for (int i = 0; i < ITERATIONS; i++) PerfCount(i % PC_COUNT);
+    double owned = MicrosecondsSince(begin) * 1000.0 / ITERATIONS;
+
+    PerfCounterBlock& shared = g_PerfBlocks[PERF_MAX_THREADS - 1];
+    begin = BenchClock::now();
+    for (int i = 0; i < ITERATIONS; i++) shared.counts[i % PC_COUNT].fetch_add(1, std::memory_order_relaxed);
+    double atomic = MicrosecondsSince(begin) * 1000.0 / ITERATIONS;
+
+    // 同样的循环只做普通自增，作为循环本身的开销
+    static volatile LONG plain[PC_COUNT];
+    begin = BenchClock::now();
+    for (int i = 0; i < ITERATIONS; i++) plain[i % PC_COUNT] = plain[i % PC_COUNT] + 1;
+    double loop = MicrosecondsSince(begin) * 1000.0 / ITERATIONS;
+
+    printf("  %-22s %6.2f ns\n", "PerfCount (owned)", owned);
+    printf("  %-22s %6.2f ns\n", "shared fetch_add", atomic);
+    printf("  %-22s %6.2f ns\n", "plain increment", loop);
+}
+
+void BenchFalseSharing() {
+    const int THREADS = 4;
+    const int ITERATIONS = 2000000;
+    const unsigned PUBLISHES = 1000000;
+    printf("  %u hardware thread(s)\n", std::thread::hardware_concurrency());
+    printf("  %-22s %12s %12s %12s\n", "", "bytes", "aligned", "packed");
+    printf("  %-22s %5d / %-4d %9.2f ns %9.2f ns\n", "perf counter blocks", (int)sizeof(PerfCounterBlock), (int)sizeof(PackedPerfBlock),
+        CounterBlockNs<PerfCounterBlock>(THREADS, ITERATIONS), CounterBlockNs<PackedPerfBlock>(THREADS, ITERATIONS));
+    printf("  %-22s %5d / %-4d %9.2f ns %9.2f ns\n", "triple buffer publish",
+        (int)sizeof(TripleBuffer<TestPayload>), (int)sizeof(TripleBuffer<TestPayload, alignof(unsigned)>),
+        TripleBufferNs<CACHE_LINE_SIZE>(PUBLISHES), TripleBufferNs<alignof(unsigned)>(PUBLISHES));
+}
+
+// --- 入口 ---
+
+struct TestCase {
+    const char* name;
+    void (*run)();
+};
+
+const TestCase TESTS[] = {
+    { "SolveSpring", TestSolveSpring },
+    { "SpringCurves", TestSpringCurves },
+    { "BankSettleTime", TestBankSettleTime },
+    { "BankLanes", TestBankLanes },
+    { "SettleSteps", TestSettleSteps },
+    { "QuantizedIdle", TestQuantizedIdle },
+    { "PhysicsReplay", TestPhysicsReplay },
+    { "SpringTuner", TestSpringTuner },
+    { "HotSwap", TestHotSwap },
+    { "HotSwapMask", TestHotSwapMask },
+    { "IdleWait", TestIdleWait },
+    { "FramePacing", TestFramePacing },
+    { "TripleBufferBasic", TestTripleBufferBasic },
+    { "TripleBufferThreads", TestTripleBufferThreads },
+    { "CommandQueueBasic", TestCommandQueueBasic },
+    { "CommandQueueThreads", TestCommandQueueThreads },
+    { "LogicCommandOverflow", TestLogicCommandOverflow },
+    { "TaskPool", TestTaskPool },
+    { "PerfCounters", TestPerfCounters },
+    { "RenderHandshake", TestRenderHandshake },
+    { "FlightFile", TestFlightFile },
+    { "Stress", TestStress }
+};
+
+const TestCase BENCHMARKS[] = {
+    { "TaskPoolLatency", BenchTaskPoolLatency },
+    { "PerfCountOverhead", BenchPerfCountOverhead },
+    { "FalseSharing", BenchFalseSharing }
+};
+
+int main(int argc, char** argv) {
+    setlocale(LC_ALL, "C.UTF-8");
+
+    // 转给 wWinMain 的命令行
+    if (argc > 1 && argv[1][0] == '/') {
+        wchar_t cmdLine[1024] = L"";
+        for (int i = 1; i < argc; i++) {
+            wchar_t arg[256];
+            if (mbstowcs(arg, argv[i], _countof(arg)) == (size_t)-1) return 1;
+            arg[_countof(arg) - 1] = 0;
+            if (wcslen(cmdLine) + wcslen(arg) + 2 > _countof(cmdLine)) return 1;
+            wcscat(cmdLine, arg);
+            wcscat(cmdLine, L" ");
+        }
+        return wWinMain(NULL, NULL, cmdLine, 0);
+    }
+
+    for (int i = 0; i < (int)_countof(TESTS); i++) {
+        if (argc > 1 && strcmp(argv[1], TESTS[i].name) != 0) continue;
+        int before = g_TestFailures;
+        TESTS[i].run();
+        printf("%-24s %s\n", TESTS[i].name, g_TestFailures == before ? "ok" : "FAILED");
+    }
+    for (int i = 0; i < (int)_countof(BENCHMARKS) && argc > 1; i++) {
+        if (strcmp(argv[1], "bench") != 0 && strcmp(argv[1], BENCHMARKS[i].name) != 0) continue;
+        printf("%s\n", BENCHMARKS[i].name);
+        BENCHMARKS[i].run();
+    }
+    printf("%d failure(s)\n", g_TestFailures);
+    return g_TestFailures;
+}
@@ -0,0 +1,241 @@
+﻿// 测试用的最小 Win32 兼容层：只提供 main.cpp 用到的类型、常量与函数签名，使其能在 Linux 下用 g++ 编译。
+// 注册表、网络等系统调用全部为返回 0 的空实现；时间取自 CLOCK_MONOTONIC，Sleep 真实等待。
+// 窗口只模拟句柄的生死、显示状态与桌面的查找 (见“模拟窗口”)，供测试检查遮罩与桌面窗口的调用
+#pragma once
+#include <stdint.h>
+#include <wchar.h>
+#include <wctype.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <atomic>
+#include <mutex>
+
+// x86-64 上启用 main.cpp 的 SSE 内核，与 Windows x64 构建走同一条路径
+#if defined(__x86_64__) && !defined(_M_X64)
+#define _M_X64 1
+#endif
+
+#define __declspec(x) __shim_##x
+#define __shim_thread __thread
+#define WINAPI
+#define APIENTRY
+#define CALLBACK
+#define TRUE 1
+#define FALSE 0
+typedef int BOOL; typedef unsigned char BYTE; typedef unsigned short WORD; typedef uint32_t DWORD; typedef int32_t LONG; typedef uint32_t UINT;
+typedef int64_t LONGLONG; typedef uint64_t ULONGLONG; typedef intptr_t LONG_PTR; typedef uintptr_t UINT_PTR; typedef uintptr_t WPARAM; typedef intptr_t LPARAM; typedef intptr_t LRESULT;
+typedef void* HANDLE; typedef struct HWND__* HWND; typedef void* HINSTANCE; typedef void* HMENU; typedef void* HKEY; typedef void* HICON; typedef void* HBRUSH; typedef void* HINTERNET; typedef void* PSID; typedef long HRESULT;
+typedef wchar_t TCHAR; typedef wchar_t* LPWSTR; typedef BYTE* LPBYTE; typedef void* LPVOID;
+#define _T(x) L##x
+#define MAX_PATH 260
+typedef union { struct { DWORD LowPart; LONG HighPart; }; LONGLONG QuadPart; } LARGE_INTEGER;
+typedef struct { LONG x, y; } POINT; typedef struct { LONG left, top, right, bottom; } RECT;
+typedef struct { HWND hwnd; UINT message; WPARAM wParam; LPARAM lParam; DWORD time; POINT pt; } MSG;
+typedef LRESULT (*WNDPROC)(HWND, UINT, WPARAM, LPARAM);
+typedef struct { UINT cbSize, style; WNDPROC lpfnWndProc; int a,b; HINSTANCE hInstance; HICON hIcon; void* hCursor; HBRUSH hbrBackground; const TCHAR* lpszMenuName; const TCHAR* lpszClassName; HICON hIconSm; } WNDCLASSEX;
+typedef struct { DWORD cbSize; HWND hWnd; UINT uID, uFlags, uCallbackMessage; HICON hIcon; TCHAR szTip[128]; } NOTIFYICONDATA;
+typedef struct { UINT cbSize; DWORD dwTime; } LASTINPUTINFO;
+typedef struct { WORD usUsagePage, usUsage; DWORD dwFlags; HWND hwndTarget; } RAWINPUTDEVICE;
+typedef uint32_t UINT32; typedef struct { UINT32 cbSize; ULONGLONG qpcRefreshPeriod, qpcVBlank; } DWM_TIMING_INFO;
+typedef uint32_t UINT32;
+typedef struct { BYTE Value[6]; } SID_IDENTIFIER_AUTHORITY;
+typedef struct { DWORD cbSize; unsigned long fMask; HWND hwnd; const TCHAR* lpVerb; const TCHAR* lpFile; const TCHAR* lpParameters; const TCHAR* lpDirectory; int nShow; } SHELLEXECUTEINFO;
+typedef struct { DWORD dwSize; DWORD th32ProcessID; TCHAR szExeFile[MAX_PATH]; } PROCESSENTRY32;
+typedef BOOL (*WNDENUMPROC)(HWND, LPARAM);
+#define WM_USER 0x400
+#define WM_QUIT 0x12
+#define WM_RBUTTONUP 0x205
+#define WM_MOUSEMOVE 0x200
+#define WM_COMMAND 0x111
+#define WM_DISPLAYCHANGE 0x7E
+#define WM_DESTROY 2
+#define WM_WTSSESSION_CHANGE 0x2B1
+#define WTS_SESSION_LOCK 7
+#define WTS_SESSION_UNLOCK 8
+#define PM_REMOVE 1
+#define PM_NOREMOVE 0
+#define PM_QS_SENDMESSAGE 0x400000
+#define QS_ALLINPUT 0x4FF
+#define QS_SENDMESSAGE 0x40
+#define MWMO_INPUTAVAILABLE 4
+#define INFINITE 0xFFFFFFFF
+#define WAIT_OBJECT_0 0
+#define SWP_NOSIZE 1
+#define SWP_NOMOVE 2
+#define SWP_NOZORDER 4
+#define SWP_NOACTIVATE 0x10
+#define SWP_FRAMECHANGED 0x20
+#define HWND_TOP ((HWND)0)
+#define HWND_MESSAGE ((HWND)-3)
+#define LWA_ALPHA 2
+#define GWL_EXSTYLE -20
+#define GWL_STYLE -16
+#define WS_EX_LAYERED 0x80000
+#define WS_EX_TRANSPARENT 0x20
+#define WS_EX_TOOLWINDOW 0x80
+#define WS_POPUP 0x80000000
+#define WS_CHILD 0x40000000
+#define WS_VISIBLE 0x10000000
+#define SW_SHOWNA 8
+#define SW_HIDE 0
+#define SW_SHOW 5
+#define SW_NORMAL 1
+#define SW_SHOWDEFAULT 10
+#define MF_BYCOMMAND 0
+#define MF_STRING 0
+#define MF_GRAYED 1
+#define MF_CHECKED 8
+#define MF_POPUP 0x10
+#define MF_SEPARATOR 0x800
+#define TPM_BOTTOMALIGN 0x20
+#define TPM_LEFTALIGN 0
+#define MB_OK 0
+#define MB_ICONERROR 0x10
+#define MB_ICONINFORMATION 0x40
+#define MB_ICONWARNING 0x30
+#define MB_ICONQUESTION 0x20
+#define MB_ICONASTERISK 0x40
+#define MB_YESNO 4
+#define MB_YESNOCANCEL 3
+#define IDYES 6
+#define IDNO 7
+#define NIF_ICON 2
+#define NIF_MESSAGE 1
+#define NIF_TIP 4
+#define NIM_ADD 0
+#define NIM_MODIFY 1
+#define NIM_DELETE 2
+#define IDI_APPLICATION ((const TCHAR*)32512)
+#define BLACK_BRUSH 4
+#define SM_CXSCREEN 0
+#define SM_CYSCREEN 1
+#define RIDEV_INPUTSINK 0x100
+#define RIDEV_REMOVE 1
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 2
+#define TIMER_ALL_ACCESS 0x1F0003
+#define THREAD_PRIORITY_ABOVE_NORMAL 1
+#define BELOW_NORMAL_PRIORITY_CLASS 0x4000
+#define DPI_AWARENESS_CONTEXT_PER_MONITOR_AWARE_V2 ((void*)-4)
+#define ERROR_ALREADY_EXISTS 183
+#define ERROR_SUCCESS 0
+#define INVALID_FILE_ATTRIBUTES 0xFFFFFFFF
+#define INVALID_HANDLE_VALUE ((HANDLE)-1)
+#define KEY_READ 1
+#define KEY_WRITE 2
+#define REG_SZ 1
+#define REG_DWORD 4
+#define HKEY_LOCAL_MACHINE ((HKEY)1)
+#define HKEY_CURRENT_USER ((HKEY)2)
+#define CSIDL_PROGRAM_FILES 0x26
+#define NOTIFY_FOR_THIS_SESSION 0
+#define PROCESS_TERMINATE 1
+#define TH32CS_SNAPPROCESS 2
+#define SECURITY_NT_AUTHORITY {{0,0,0,0,0,5}}
+#define SECURITY_BUILTIN_DOMAIN_RID 32
+#define DOMAIN_ALIAS_RID_ADMINS 544
+#define INTERNET_OPEN_TYPE_PRECONFIG 0
+#define INTERNET_OPTION_CONNECT_TIMEOUT 2
+#define INTERNET_OPTION_RECEIVE_TIMEOUT 6
+#define INTERNET_OPTION_URL 34
+#define INTERNET_FLAG_RELOAD 1
+#define INTERNET_FLAG_NO_CACHE_WRITE 2
+#define INTERNET_FLAG_NO_COOKIES 4
+#define INTERNET_FLAG_NO_UI 8
+#define LOWORD(x) ((WORD)((x)&0xffff))
+#define SUCCEEDED(x) ((x)>=0)
+#define FAILED(x) ((x)<0)
+#define _isnan isnan
+#define _finite isfinite
+// 空实现：接受任意参数，返回 0 (失败、空句柄或未找到)
+#define STUB0(ret, name) static inline ret name(...) { return (ret)0; }
+STUB0(BOOL,SetProcessDpiAwarenessContext) STUB0(BOOL,SetPriorityClass) STUB0(HANDLE,GetCurrentProcess) STUB0(DWORD,GetModuleFileName)
+STUB0(HANDLE,CreateMutex) STUB0(UINT,RegisterWindowMessage) STUB0(BOOL,WTSRegisterSessionNotification) STUB0(BOOL,WTSUnRegisterSessionNotification)
+STUB0(HANDLE,CreateWaitableTimer) STUB0(HANDLE,CreateWaitableTimerEx) STUB0(BOOL,PeekMessage) STUB0(BOOL,TranslateMessage) STUB0(LRESULT,DispatchMessage)
+STUB0(BOOL,GetCursorPos) STUB0(BOOL,CloseHandle) STUB0(BOOL,InternetCloseHandle) STUB0(BOOL,InternetQueryOption)
+STUB0(HINTERNET,InternetOpenUrl) STUB0(HINTERNET,InternetOpen) STUB0(BOOL,InternetSetOption) STUB0(HRESULT,StringCchCopy) STUB0(BOOL,PostMessage)
+STUB0(BOOL,ModifyMenu) STUB0(BOOL,InvalidateRect) STUB0(BOOL,UpdateWindow)
+STUB0(BOOL,SetForegroundWindow) STUB0(HMENU,CreatePopupMenu) STUB0(BOOL,AppendMenu) STUB0(BOOL,TrackPopupMenu) STUB0(BOOL,DestroyMenu)
+STUB0(int,MessageBox) STUB0(void*,ShellExecute) STUB0(BOOL,ShellExecuteEx) STUB0(BOOL,CancelWaitableTimer) STUB0(BOOL,SetWaitableTimer)
+STUB0(DWORD,MsgWaitForMultipleObjectsEx) STUB0(DWORD,MsgWaitForMultipleObjects) STUB0(DWORD,WaitForSingleObject) STUB0(HRESULT,DwmFlush) STUB0(HRESULT,DwmGetCompositionTimingInfo)
+STUB0(BOOL,GetLastInputInfo) STUB0(BOOL,RegisterRawInputDevices) STUB0(HRESULT,SHGetFolderPath)
+STUB0(BOOL,SetThreadPriority) STUB0(LONG_PTR,GetWindowLongPtr) STUB0(LONG_PTR,SetWindowLongPtr) STUB0(void*,GetStockObject) STUB0(WORD,RegisterClassEx)
+STUB0(HWND,CreateWindow) STUB0(BOOL,EnumWindows)
+STUB0(HICON,LoadIcon) STUB0(BOOL,Shell_NotifyIcon) STUB0(BOOL,AllocateAndInitializeSid) STUB0(BOOL,CheckTokenMembership) STUB0(void*,FreeSid)
+STUB0(HANDLE,CreateToolhelp32Snapshot) STUB0(BOOL,Process32First) STUB0(BOOL,Process32Next) STUB0(DWORD,GetCurrentProcessId) STUB0(HANDLE,OpenProcess) STUB0(BOOL,TerminateProcess)
+STUB0(DWORD,GetFileAttributes) STUB0(LONG,RegOpenKeyEx) STUB0(LONG,RegQueryValueEx) STUB0(LONG,RegCloseKey) STUB0(BOOL,CreateDirectory) STUB0(DWORD,GetLastError) STUB0(BOOL,CopyFile)
+STUB0(LONG,RegCreateKeyEx) STUB0(LONG,RegSetValueEx) STUB0(LONG,RegDeleteKey) STUB0(LONG,RegDeleteValue) STUB0(DWORD,GetWindowThreadProcessId) STUB0(HINSTANCE,GetModuleHandle)
+
+// --- 模拟窗口 ---
+// CreateWindowEx 分配假句柄，DestroyWindow 使其失效；IsWindow、IsWindowVisible 只对存活 (且显示) 的窗口为真。
+// ShimCreateDesktop 建立桌面：FindWindow 找到 Progman，FindWindowEx 找到其下的 SHELLDLL_DefView，两者的尺寸即屏幕尺寸。
+// 对本进程创建后又销毁的窗口调用 SetWindowPos/SetLayeredWindowAttributes 计入 deadHandleCalls；
+// 两者的调用转给测试设置的钩子 (在启动其他线程之前设置)
+#define SHIM_MAX_WINDOWS 4096
+struct ShimWindow { bool alive, visible, owned; HWND parent; };
+static struct ShimState {
+    std::mutex m;
+    ShimWindow windows[SHIM_MAX_WINDOWS];
+    int count;
+    HWND progman, shellView;
+    int screenW, screenH;
+    std::atomic<HWND> cursorWindow;     // WindowFromPoint 的返回值
+    std::atomic<int> deadHandleCalls;
+    void (*onSetWindowPos)(HWND hwnd, int x, int y, int cx, int cy, UINT flags);
+    void (*onSetLayered)(HWND hwnd, BYTE alpha);
+} g_Shim;
+static inline HWND ShimHandle(int i){ return (HWND)(intptr_t)(0x10000 + i * 16); }
+static inline ShimWindow* ShimFind(HWND hwnd){ intptr_t i = ((intptr_t)hwnd - 0x10000) / 16; return ((intptr_t)hwnd - 0x10000) % 16 == 0 && i >= 0 && i < g_Shim.count ? &g_Shim.windows[i] : NULL; }
+static inline HWND ShimNewWindow(HWND parent, bool visible, bool owned){ std::lock_guard<std::mutex> l(g_Shim.m); if (g_Shim.count == SHIM_MAX_WINDOWS) return NULL;
+    ShimWindow& w = g_Shim.windows[g_Shim.count]; w.alive = true; w.visible = visible; w.owned = owned; w.parent = parent; return ShimHandle(g_Shim.count++); }
+static inline void ShimCheckAlive(HWND hwnd){ std::lock_guard<std::mutex> l(g_Shim.m); ShimWindow* w = ShimFind(hwnd); if (w && w->owned && !w->alive) g_Shim.deadHandleCalls++; }
+static inline void ShimCreateDesktop(int w, int h){ g_Shim.progman = ShimNewWindow(NULL, true, false); g_Shim.shellView = ShimNewWindow(g_Shim.progman, true, false); g_Shim.screenW = w; g_Shim.screenH = h; }
+static inline HWND CreateWindowEx(DWORD, const TCHAR*, const TCHAR*, DWORD style, int, int, int, int, HWND parent, HMENU, HINSTANCE, LPVOID){ return ShimNewWindow(parent, (style & 0x10000000) != 0, true); }
+static inline BOOL DestroyWindow(HWND hwnd){ std::lock_guard<std::mutex> l(g_Shim.m); ShimWindow* w = ShimFind(hwnd); if (!w || !w->alive) return 0; w->alive = false; return 1; }
+static inline BOOL IsWindow(HWND hwnd){ std::lock_guard<std::mutex> l(g_Shim.m); ShimWindow* w = ShimFind(hwnd); return w && w->alive; }
+static inline BOOL IsWindowVisible(HWND hwnd){ std::lock_guard<std::mutex> l(g_Shim.m); ShimWindow* w = ShimFind(hwnd); return w && w->alive && w->visible; }
+static inline BOOL ShowWindow(HWND hwnd, int cmd){ std::lock_guard<std::mutex> l(g_Shim.m); ShimWindow* w = ShimFind(hwnd); if (!w || !w->alive) return 0; BOOL was = w->visible; w->visible = (cmd != 0); return was; }
+static inline HWND SetParent(HWND hwnd, HWND parent){ std::lock_guard<std::mutex> l(g_Shim.m); ShimWindow* w = ShimFind(hwnd); if (!w || !w->alive) return NULL; HWND old = w->parent; w->parent = parent; return old; }
+static inline HWND GetParent(HWND hwnd){ std::lock_guard<std::mutex> l(g_Shim.m); ShimWindow* w = ShimFind(hwnd); return w && w->alive ? w->parent : NULL; }
+static inline HWND FindWindow(const TCHAR* cls, const TCHAR*){ return cls && wcscmp(cls, L"Progman") == 0 && IsWindow(g_Shim.progman) ? g_Shim.progman : NULL; }
+static inline HWND FindWindowEx(HWND parent, HWND, const TCHAR* cls, const TCHAR*){ return parent && parent == g_Shim.progman && cls && wcscmp(cls, L"SHELLDLL_DefView") == 0 && IsWindow(g_Shim.shellView) ? g_Shim.shellView : NULL; }
+static inline BOOL GetWindowRect(HWND hwnd, RECT* r){ r->left = r->top = 0; r->right = r->bottom = 0; if (!IsWindow(hwnd)) return 0; r->right = g_Shim.screenW; r->bottom = g_Shim.screenH; return 1; }
+static inline int GetSystemMetrics(int index){ return index == 0 ? g_Shim.screenW : index == 1 ? g_Shim.screenH : 0; }
+static inline HWND WindowFromPoint(POINT){ return g_Shim.cursorWindow.load(); }
+static inline BOOL SetWindowPos(HWND hwnd, HWND, int x, int y, int cx, int cy, UINT flags){ ShimCheckAlive(hwnd); if (g_Shim.onSetWindowPos) g_Shim.onSetWindowPos(hwnd, x, y, cx, cy, flags); return IsWindow(hwnd); }
+static inline BOOL SetLayeredWindowAttributes(HWND hwnd, DWORD, BYTE alpha, DWORD){ ShimCheckAlive(hwnd); if (g_Shim.onSetLayered) g_Shim.onSetLayered(hwnd, alpha); return IsWindow(hwnd); }
+
+// 临时目录取 TMPDIR (缺省 /tmp/)，帧记录等输出文件不会落在当前目录
+static inline DWORD GetTempPath(DWORD n, TCHAR* buf){ const char* t = getenv("TMPDIR"); swprintf(buf, n, L"%s/", t && *t ? t : "/tmp"); return (DWORD)wcslen(buf); }
+static inline TCHAR* PathCombine(TCHAR* out, const TCHAR* dir, const TCHAR* file){ swprintf(out, MAX_PATH, L"%ls%ls", dir, file); return out; }
+static inline void Sleep(DWORD ms){ usleep(ms*1000); }
+static inline ULONGLONG GetTickCount64(){ timespec t; clock_gettime(CLOCK_MONOTONIC,&t); return t.tv_sec*1000ULL+t.tv_nsec/1000000; }
+static inline DWORD GetTickCount(){ return (DWORD)GetTickCount64(); }
+static inline BOOL QueryPerformanceCounter(LARGE_INTEGER* p){ timespec t; clock_gettime(CLOCK_MONOTONIC,&t); p->QuadPart=t.tv_sec*1000000000LL+t.tv_nsec; return 1; }
+static inline BOOL QueryPerformanceFrequency(LARGE_INTEGER* p){ p->QuadPart=1000000000LL; return 1; }
+#define _tcsstr wcsstr
+#define _tcslen wcslen
+#define _tcsrchr wcsrchr
+#define _tcstod wcstod
+#define _ttoi(s) ((int)wcstol(s,0,10))
+#define _tcsicmp wcscasecmp
+#define _tcsnicmp wcsncasecmp
+#include <stdarg.h>
+#include <wctype.h>
+static inline void __fixfmt(const wchar_t* f, wchar_t* o){ while(*f){ if(*f==L'%'){ *o++=*f++; while(*f && !iswalpha(*f) && *f!=L'%') *o++=*f++; if(*f==L's'){*o++=L'l';} } *o++=*f++; } *o=0; }
+static inline int _ftprintf(FILE* fp, const wchar_t* f, ...){ wchar_t ff[1024]; __fixfmt(f,ff); va_list a; va_start(a,f); int r=vfwprintf(fp,ff,a); va_end(a); return r; }
+static inline int _tcscpy_s(TCHAR* d, size_t n, const TCHAR* s){ wcsncpy(d,s,n); d[n-1]=0; return 0; }
+#define _stprintf_s swprintf
+static inline int _tfopen_s(FILE** f, const TCHAR* p, const TCHAR* m){ char pp[1024], mm[16]; wcstombs(pp,p,1024); wcstombs(mm,m,16); char* c=strchr(mm,','); if(c)*c=0; *f=fopen(pp,mm); return *f?0:1; }
+#define _countof(a) (sizeof(a)/sizeof((a)[0]))
+static inline LRESULT DefWindowProc(HWND, UINT, WPARAM, LPARAM){ return 0; }
+typedef DWORD (*LPTHREAD_START_ROUTINE)(LPVOID);
+static inline LONG InterlockedDecrement(volatile LONG* p){ return __sync_sub_and_fetch(p,1); }
+static inline LONG InterlockedIncrement(volatile LONG* p){ return __sync_add_and_fetch(p,1); }
+STUB0(HANDLE,CreateThread) STUB0(HANDLE,CreateEvent) STUB0(BOOL,SetEvent) STUB0(DWORD,WaitForMultipleObjects)
+#define WAIT_TIMEOUT 258
+#define CREATE_SUSPENDED 4
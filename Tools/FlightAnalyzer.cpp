@@ -0,0 +1,198 @@
+﻿// AutoICON 帧记录分析工具
+// 读取托盘菜单“导出帧记录”或卡顿时自动保存的 AutoICON_Flight.bin，输出各阶段耗时的分位数、卡顿帧与耗时构成。
+// 只依赖标准库，可在 Linux 下编译运行：
+//     g++ -std=c++11 -O2 Tools/FlightAnalyzer.cpp -o FlightAnalyzer
+//     ./FlightAnalyzer AutoICON_Flight.bin [--hitch-ms N] [--csv]
+// 文件格式与 main.cpp 中的 FlightFileHeader / FlightFrame 一致 (小端，各 32 字节)，修改时两边同步并递增版本号
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+
+#define FLIGHT_MAGIC   0x52464941u // "AIFR"
+#define FLIGHT_VERSION 1
+#define HEADER_SIZE    32
+#define FRAME_SIZE     32
+#define MAX_HITCH_ROWS 20          // 卡顿帧最多列出的行数
+
+struct Header {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t frameSize;
+    uint32_t count;
+    uint32_t periodUs;
+    uint32_t reason;
+    uint32_t profile;
+    uint32_t capFps;
+    uint32_t hitchMs;
+};
+
+struct Frame {
+    uint32_t frame;
+    uint32_t intervalUs;  // 动画的第一帧为 0
+    uint32_t dtUs;
+    uint32_t applyUs;
+    uint32_t physicsUs;
+    uint32_t waitUs;
+    int32_t lateUs;
+    uint8_t setWindowPos;
+    uint8_t setLayered;
+    uint8_t enforceZOrder;
+    uint8_t timerWaits;
+};
+
+// 按字节解码，与主机字节序无关
+uint32_t U32(const unsigned char* p) { return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24); }
+uint16_t U16(const unsigned char* p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+
+bool ReadFlightFile(const char* path, Header& h, std::vector<Frame>& frames) {
+    FILE* fp = fopen(path, "rb");
+    if (!fp) { fprintf(stderr, "cannot open %s\n", path); return false; }
+    unsigned char buf[HEADER_SIZE];
+    bool ok = fread(buf, 1, HEADER_SIZE, fp) == HEADER_SIZE;
+    if (ok) {
+        h.magic = U32(buf);
+        h.version = U16(buf + 4);
+        h.frameSize = U16(buf + 6);
+        h.count = U32(buf + 8);
+        h.periodUs = U32(buf + 12);
+        h.reason = U32(buf + 16);
+        h.profile = U32(buf + 20);
+        h.capFps = U32(buf + 24);
+        h.hitchMs = U32(buf + 28);
+        ok = (h.magic == FLIGHT_MAGIC && h.version == FLIGHT_VERSION && h.frameSize == FRAME_SIZE);
+        if (!ok) fprintf(stderr, "%s: not a version %d frame log\n", path, FLIGHT_VERSION);
+    }
+    for (uint32_t i = 0; ok && i < h.count; i++) {
+        unsigned char r[FRAME_SIZE];
+        if (fread(r, 1, FRAME_SIZE, fp) != FRAME_SIZE) {
+            fprintf(stderr, "%s: truncated after %u of %u frames\n", path, i, h.count);
+            break; // 保留已读到的帧
+        }
+        Frame f;
+        f.frame = U32(r);
+        f.intervalUs = U32(r + 4);
+        f.dtUs = U32(r + 8);
+        f.applyUs = U32(r + 12);
+        f.physicsUs = U32(r + 16);
+        f.waitUs = U32(r + 20);
+        f.lateUs = (int32_t)U32(r + 24);
+        f.setWindowPos = r[28];
+        f.setLayered = r[29];
+        f.enforceZOrder = r[30];
+        f.timerWaits = r[31];
+        frames.push_back(f);
+    }
+    fclose(fp);
+    return ok;
+}
+
+// 最近秩法取分位数，values 须已排序
+double Percentile(const std::vector<double>& values, double p) {
+    if (values.empty()) return 0.0;
+    size_t rank = (size_t)(p / 100.0 * values.size() + 0.999999);
+    if (rank < 1) rank = 1;
+    if (rank > values.size()) rank = values.size();
+    return values[rank - 1];
+}
+
+void PrintPercentiles(const char* name, std::vector<double> values) {
+    std::sort(values.begin(), values.end());
+    printf("  %-10s %9.2f %9.2f %9.2f %9.2f %9.2f\n", name,
+        Percentile(values, 50), Percentile(values, 90), Percentile(values, 99), Percentile(values, 99.9), values.empty() ? 0.0 : values.back());
+}
+
+void PrintCsv(const std::vector<Frame>& frames) {
+    printf("frame,interval_us,dt_us,apply_us,physics_us,wait_us,late_us,set_window_pos,set_layered,enforce_zorder,timer_waits\n");
+    for (size_t i = 0; i < frames.size(); i++) {
+        const Frame& f = frames[i];
+        printf("%u,%u,%u,%u,%u,%u,%d,%u,%u,%u,%u\n", f.frame, f.intervalUs, f.dtUs, f.applyUs, f.physicsUs, f.waitUs, f.lateUs,
+            f.setWindowPos, f.setLayered, f.enforceZOrder, f.timerWaits);
+    }
+}
+
+int main(int argc, char** argv) {
+    const char* path = NULL;
+    double hitchMs = -1.0;
+    bool csv = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--hitch-ms") == 0 && i + 1 < argc) hitchMs = atof(argv[++i]);
+        else if (strcmp(argv[i], "--csv") == 0) csv = true;
+        else path = argv[i];
+    }
+    if (!path) {
+        fprintf(stderr, "usage: %s AutoICON_Flight.bin [--hitch-ms N] [--csv]\n", argv[0]);
+        return 2;
+    }
+
+    Header h;
+    std::vector<Frame> frames;
+    if (!ReadFlightFile(path, h, frames)) return 1;
+    if (csv) { PrintCsv(frames); return 0; }
+    if (hitchMs < 0.0) hitchMs = h.hitchMs;
+
+    printf("%s: %u frames, saved %s, profile %u, refresh %.2f Hz, ", path, (unsigned)frames.size(),
+        h.reason == 1 ? "after a hitch" : "manually", h.profile, h.periodUs ? 1e6 / h.periodUs : 0.0);
+    if (h.capFps) printf("cap %u fps\n", h.capFps);
+    else printf("no cap\n");
+    if (frames.empty()) return 0;
+
+    // 各阶段的分位数 (毫秒)。间隔不含每段动画的第一帧
+    std::vector<double> interval, apply, physics, wait, late;
+    double sumApply = 0, sumPhysics = 0, sumWait = 0;
+    double calls[4] = { 0, 0, 0, 0 };
+    int animations = 0;
+    for (size_t i = 0; i < frames.size(); i++) {
+        const Frame& f = frames[i];
+        if (f.intervalUs == 0) animations++;
+        else interval.push_back(f.intervalUs / 1000.0);
+        apply.push_back(f.applyUs / 1000.0);
+        physics.push_back(f.physicsUs / 1000.0);
+        wait.push_back(f.waitUs / 1000.0);
+        late.push_back(f.lateUs / 1000.0);
+        sumApply += f.applyUs;
+        sumPhysics += f.physicsUs;
+        sumWait += f.waitUs;
+        calls[0] += f.setWindowPos;
+        calls[1] += f.setLayered;
+        calls[2] += f.enforceZOrder;
+        calls[3] += f.timerWaits;
+    }
+    printf("  %d animation(s)\n\n", animations);
+
+    printf("per-frame (ms)      p50       p90       p99     p99.9       max\n");
+    PrintPercentiles("interval", interval);
+    PrintPercentiles("apply", apply);
+    PrintPercentiles("physics", physics);
+    PrintPercentiles("wait", wait);
+    PrintPercentiles("late", late);
+
+    // 耗时构成：一帧的时间由提交、推进与等待三段组成，等待占比低说明渲染线程自身成了瓶颈
+    double total = sumApply + sumPhysics + sumWait;
+    if (total <= 0) total = 1;
+    double n = (double)frames.size();
+    printf("\nbreakdown           mean ms   share\n");
+    printf("  %-10s %9.3f %6.1f%%\n", "apply", sumApply / n / 1000.0, sumApply * 100.0 / total);
+    printf("  %-10s %9.3f %6.1f%%\n", "physics", sumPhysics / n / 1000.0, sumPhysics * 100.0 / total);
+    printf("  %-10s %9.3f %6.1f%%\n", "wait", sumWait / n / 1000.0, sumWait * 100.0 / total);
+    printf("\nWin32 calls per frame: SetWindowPos %.2f, SetLayeredWindowAttributes %.2f, EnforceZOrder %.3f, timer waits %.2f\n",
+        calls[0] / n, calls[1] / n, calls[2] / n, calls[3] / n);
+
+    // 卡顿帧：醒来晚于计划的垂直同步超过阈值
+    int hitches = 0;
+    for (size_t i = 0; i < frames.size(); i++) {
+        const Frame& f = frames[i];
+        if (f.lateUs <= hitchMs * 1000.0) continue;
+        if (hitches == 0) printf("\nhitches (late > %.1f ms)\n  frame   interval    apply  physics     wait     late  calls\n", hitchMs);
+        if (hitches < MAX_HITCH_ROWS) {
+            printf("  %-7u %8.2f %8.2f %8.2f %8.2f %8.2f  %u/%u/%u\n", f.frame, f.intervalUs / 1000.0, f.applyUs / 1000.0,
+                f.physicsUs / 1000.0, f.waitUs / 1000.0, f.lateUs / 1000.0, f.setWindowPos, f.setLayered, f.enforceZOrder);
+        }
+        hitches++;
+    }
+    if (hitches > MAX_HITCH_ROWS) printf("  ... %d more\n", hitches - MAX_HITCH_ROWS);
+    printf("\n%d hitch(es) in %u frames\n", hitches, (unsigned)frames.size());
+    return 0;
+}
@@ -13,6 +13,22 @@
 #include <tlhelp32.h>
 #include <wininet.h>
 #include <strsafe.h>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <system_error>
+#include <chrono>
+
+// 弹簧组的 SSE 内核：x64 与启用 /arch:SSE 的 x86 构建可用，否则退回标量实现
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define SPRING_BANK_SSE
+#include <xmmintrin.h>
+#endif
+
+// 定义 SPRING_FIXED_POINT 后，弹簧组推进与渲染插值改用定点整数运算：
+// 渲染结果与浮点路径相差不超过 1 个单位，热路径上不会产生 NaN/Inf
+// #define SPRING_FIXED_POINT
 
 // 链接必要的系统库
 #pragma comment(lib, "dwmapi.lib")
@@ -44,15 +60,22 @@
 #define REG_SUBKEY        _T("Software\\AutoICON")
 #define REG_VAL_PROFILE   _T("LastProfileIndex")
 #define REG_VAL_MASK      _T("MaskOpacityIndex")
+#define REG_VAL_FRAMECAP  _T("FrameRateCapIndex")
 
 // 消息与菜单ID
 #define WM_TRAYICON          (WM_USER + 1)
+#define WM_RENDER_IDLE       (WM_USER + 2) // 渲染线程进入静止，唤醒逻辑循环重新规划等待
+#define WM_FLIGHT_SAVED      (WM_USER + 3) // 帧记录已写出：wParam 为原因，lParam 为是否成功
+#define WM_LOGIC_COMMAND     (WM_USER + 4) // 命令队列中有新命令，唤醒主循环
 #define WM_UPDATE_UI_REFRESH (WM_USER + 200)
 #define ID_TRAY_EXIT         9001
 #define ID_TRAY_AUTOSTART    9002
+#define ID_TRAY_COUNTERS     9003
+#define ID_TRAY_FLIGHT       9004
 #define ID_TRAY_UPDATE       9300
 #define ID_PROFILE_START     9100
 #define ID_MASK_START        9200
+#define ID_FRAMECAP_START    9400
 
 // 启动状态机常量 (原代码缺失)
 #define STARTUP_PHASE_1_HIDING  0
@@ -63,20 +86,142 @@
 // 动画与时间常量 (原代码缺失)
 #define STARTUP_TRANSITION_DELAY 500   // 切换配置时的等待毫秒数
 #define STARTUP_SPEED_FACTOR     0.7f  // 启动/切换时的动画加速倍率
+#define PHYSICS_STEP_MIN (1.0f / 1000.0f) // 物理步长下限 (秒)
+#define PHYSICS_STEP_MAX (1.0f / 30.0f)   // 物理步长上限 (秒)，慢弹簧每帧只需一步
+#define INTERP_TOLERANCE 1e-3             // 相邻两步之间线性插值渲染允许的相对误差
+#define MAX_FRAME_DELTA  0.25f            // 单帧最多推进的时间 (秒)
+#define FRAME_STRETCH_MAX_MS 50           // 动画尾段两帧的最长间隔，也是尾段中响应鼠标的最长延迟
+#define FRAME_STRETCH_DELTA  0.9f         // 尾段推迟提交时两帧之间允许的最大变化，留出插值误差的余量
+#define LOGIC_POLL_MS        30           // 动画进行中逻辑线程检查鼠标的间隔
+#define LOGIC_QUEUE_SIZE     64           // 逻辑线程命令队列的容量 (2 的幂)
+
+// 后台任务池
+#define TASK_POOL_THREADS      3            // 常驻工作线程数，低优先级任务最多同时占用其中 TASK_POOL_THREADS - 1 个
+#define TASK_POOL_CAPACITY     16           // 排队中 (未开始) 的任务上限
+#define DISPLAY_RESET_DELAY_MS 500          // 显示设置变化后，等待显示稳定再重新定位桌面
+
+// 帧记录 (Flight Recorder)
+#define FLIGHT_FRAMES          1024         // 环形缓冲容量，约为 120 Hz 下 8 秒的动画
+#define FLIGHT_HITCH_MS        20           // 醒来晚于计划的垂直同步超过此值视为卡顿，动画结束后自动保存
+#define FLIGHT_AUTOSAVE_GAP_MS 600000       // 两次自动保存的最小间隔
+#define FLIGHT_MAGIC           0x52464941   // 文件头 "AIFR"
+#define FLIGHT_VERSION         1
+#define FLIGHT_FILE_NAME       _T("AutoICON_Flight.bin")
 
 // 物理引擎参数
 struct SpringParams {
     float tension;
     float friction;
     bool  enabled;
+    float maxStep;   // 最大物理步长：两步之间线性插值的误差不超过 INTERP_TOLERANCE
+    float duration;  // 大于 0 时为定长缓动曲线 (秒)，忽略 tension/friction
+    float bezier[4]; // 缓动曲线的控制点 x1, y1, x2, y2 (CSS cubic-bezier 语义)
 };
 
+// 插值误差约为 h²·ω²/8 (ω² = tension)，据此反推步长
+SpringParams MakeSpring(float tension, float friction) {
+    SpringParams p = { tension, friction, tension > 0.0f, PHYSICS_STEP_MAX, 0.0f, { 0.0f, 0.0f, 0.0f, 0.0f } };
+    if (p.enabled) {
+        float h = (float)(sqrt(8.0 * INTERP_TOLERANCE) / sqrt((double)tension));
+        if (h < PHYSICS_STEP_MIN) h = PHYSICS_STEP_MIN;
+        if (h > PHYSICS_STEP_MAX) h = PHYSICS_STEP_MAX;
+        p.maxStep = h;
+    }
+    return p;
+}
+
+// 三次贝塞尔的一个坐标分量及其导数，端点固定为 0 与 1
+double BezierCoord(double p1, double p2, double s) {
+    double c = 3.0 * p1, b = 3.0 * (p2 - p1) - c, a = 1.0 - c - b;
+    return ((a * s + b) * s + c) * s;
+}
+
+double BezierSlope(double p1, double p2, double s) {
+    double c = 3.0 * p1, b = 3.0 * (p2 - p1) - c, a = 1.0 - c - b;
+    return (3.0 * a * s + 2.0 * b) * s + c;
+}
+
+// 给定进度 x 求缓动值 y 与 dy/dx：先牛顿迭代求曲线参数，不收敛时退回二分
+void CubicBezierEase(const float* cp, double x, double& y, double& slope) {
+    double s = x;
+    for (int i = 0; i < 8; i++) {
+        double err = BezierCoord(cp[0], cp[2], s) - x;
+        double d = BezierSlope(cp[0], cp[2], s);
+        if (fabs(err) < 1e-7 || fabs(d) < 1e-6) break;
+        s -= err / d;
+    }
+    if (!(s >= 0.0 && s <= 1.0) || fabs(BezierCoord(cp[0], cp[2], s) - x) > 1e-6) {
+        double lo = 0.0, hi = 1.0;
+        for (int i = 0; i < 40; i++) {
+            s = 0.5 * (lo + hi);
+            if (BezierCoord(cp[0], cp[2], s) < x) lo = s; else hi = s;
+        }
+    }
+    y = BezierCoord(cp[1], cp[3], s);
+    double dx = BezierSlope(cp[0], cp[2], s);
+    slope = (dx > 1e-9) ? BezierSlope(cp[1], cp[3], s) / dx : 0.0;
+}
+
+// 定长缓动曲线：有确定的结束时刻，与弹簧共用曲线表与推进路径。
+// 步长同样按插值误差 h²·|x''|/8 反推，x'' 取曲线上二阶差分的最大值
+SpringParams MakeBezier(float durationMs, float x1, float y1, float x2, float y2) {
+    SpringParams p = { 0.0f, 0.0f, true, PHYSICS_STEP_MAX, durationMs / 1000.0f, { x1, y1, x2, y2 } };
+    const int n = 64;
+    double d = 1.0 / n, maxAccel = 0.0, y0, y1v, y2v, slope;
+    for (int k = 1; k < n; k++) {
+        CubicBezierEase(p.bezier, (k - 1) * d, y0, slope);
+        CubicBezierEase(p.bezier, k * d, y1v, slope);
+        CubicBezierEase(p.bezier, (k + 1) * d, y2v, slope);
+        double accel = fabs(y2v - 2.0 * y1v + y0) / (d * d) / ((double)p.duration * p.duration);
+        if (accel > maxAccel) maxAccel = accel;
+    }
+    if (maxAccel > 0.0) {
+        float h = (float)sqrt(8.0 * INTERP_TOLERANCE / maxAccel);
+        if (h < PHYSICS_STEP_MIN) h = PHYSICS_STEP_MIN;
+        if (h < p.maxStep) p.maxStep = h;
+    }
+    return p;
+}
+
 // 预设物理参数
-const SpringParams SP_FAST = { 860.0f, 46.0f, true };
-const SpringParams SP_NORMAL = { 400.0f, 32.0f, true };
-const SpringParams SP_SLOW = { 12.0f,  5.0f, true };
-const SpringParams SP_VERYSLOW = { 6.0f,  3.0f,  true };
-const SpringParams SP_OFF = { 0.0f,   0.0f,  false };
+const SpringParams SP_FAST = MakeSpring(860.0f, 46.0f);
+const SpringParams SP_NORMAL = MakeSpring(400.0f, 32.0f);
+const SpringParams SP_SLOW = MakeSpring(12.0f, 5.0f);
+const SpringParams SP_VERYSLOW = MakeSpring(6.0f, 3.0f);
+const SpringParams SP_OFF = MakeSpring(0.0f, 0.0f);
+const SpringParams SP_EASE_SHOW = MakeBezier(250.0f, 0.0f, 0.0f, 0.58f, 1.0f);  // ease-out：减速进入
+const SpringParams SP_EASE_HIDE = MakeBezier(600.0f, 0.42f, 0.0f, 0.58f, 1.0f); // ease-in-out
+
+// 预烘焙动画曲线：单位初始条件下的响应，运行时按线性叠加还原任意起点
+#define CURVE_SAMPLES      256     // 每条曲线的采样点数
+#define CURVE_SETTLE_RATIO 1e-4    // 单位响应衰减到该比例即视为曲线结束
+
+struct CurveSample {
+    float pos, vel;   // 初始位移 1、初速度 0 时的位移与速度
+    float posV, velV; // 初始位移 0、初速度 1 时的位移与速度
+};
+
+// 定点格式 (SPRING_FIXED_POINT)：通道值为 Q8 (1/256 像素或透明度单位)，曲线系数为 Q16，时间以微秒计
+#define FIXED_VALUE_SHIFT 8
+#define FIXED_CURVE_SHIFT 16
+#define FIXED_LIMIT       0x3FFFFFFF // 换算时的饱和范围，±FLT_MAX 之类的哨兵值映射到此
+#define FIXED_ELAPSED_CAP 0x3FFFFFFF // 段内时间的上限 (约 18 分钟)，远超任何曲线时长
+
+struct CurveSampleQ {
+    int pos, vel;
+    int posV, velV;
+};
+
+struct SpringCurve {
+    SpringParams params; // 烘焙所用的参数，用于查找
+    float invStep;    // 采样间隔的倒数
+    int stepUs;       // 采样间隔 (微秒)，烘焙时按整微秒取样，浮点与定点路径共用同一时间基准
+    CurveSample s[CURVE_SAMPLES];
+#ifdef SPRING_FIXED_POINT
+    long long invStepQ; // 采样间隔倒数 (Q32/微秒)，以乘法代替整数除法
+    CurveSampleQ q[CURVE_SAMPLES];
+#endif
+};
 
 // 配置档案结构
 struct ConfigProfile {
@@ -96,7 +241,10 @@ const ConfigProfile PRESETS[] = {
     { _T("抽屉 (快速) - Drawer (Fast)"), 5000, 100, SP_FAST, SP_SLOW, SP_OFF, SP_OFF },
     { _T("滑动 (默认) - Silde (Default)"), 6000, 200, SP_NORMAL, SP_VERYSLOW, SP_NORMAL, SP_VERYSLOW },
     { _T("滑动 (快速) - Silde (Fast)"), 4000, 100, SP_FAST, SP_SLOW, SP_FAST, SP_SLOW },
-    { _T("常显 - Always Show"), 0xFFFFFFFF, 1000, SP_FAST, SP_FAST, SP_FAST, SP_FAST }
+    { _T("常显 - Always Show"), 0xFFFFFFFF, 1000, SP_FAST, SP_FAST, SP_FAST, SP_FAST },
+    // 缓动预设追加在末尾，已保存的配置序号保持不变
+    { _T("渐变 (缓动) - Fade (Eased)"), 5000, 200, SP_OFF, SP_OFF, SP_EASE_SHOW, SP_EASE_HIDE },
+    { _T("抽屉 (缓动) - Drawer (Eased)"), 8000, 200, SP_EASE_SHOW, SP_EASE_HIDE, SP_OFF, SP_OFF }
 };
 const int PRESET_COUNT = (int)(sizeof(PRESETS) / sizeof(PRESETS[0]));
 
@@ -113,6 +261,10 @@ const MaskOption MASK_OPTIONS[] = {
 };
 const int MASK_OPT_COUNT = (int)(sizeof(MASK_OPTIONS) / sizeof(MASK_OPTIONS[0]));
 
+// 动画帧率上限 (节能)，0 表示跟随显示器刷新率。可以不是刷新率的整数约数
+const int FRAME_CAP_OPTIONS[] = { 0, 30, 60, 120 };
+const int FRAME_CAP_COUNT = (int)(sizeof(FRAME_CAP_OPTIONS) / sizeof(FRAME_CAP_OPTIONS[0]));
+
 // 更新检测状态
 enum UpdateStatus {
     US_IDLE,            // 未启动
@@ -129,13 +281,570 @@ const TCHAR* MIRRORS[] = {
 };
 #define UPDATE_TIMEOUT_MS 5000 // 网络超时设置
 
+// 物理基准测试参数 (/bench)，固定屏幕尺寸以便不同机器的结果可比
+#define BENCH_SCREEN_W   1920
+#define BENCH_SCREEN_H   1080
+#define BENCH_MASK_ALPHA 128
+#define BENCH_FRAME_DT   (1.0f / 60.0f)
+#define BENCH_MAX_STEPS  (240 * 30)
+#define BENCH_REPEAT     200
+#define BENCH_LANES      3 // 位置、透明度、蒙版
+
+#define BENCH_IDLE_SPAN_MS (3600ULL * 1000) // 空闲模拟时长：鼠标静止一小时 (虚拟时钟)
+
+// 一个配置在鼠标静止期间的主循环开销
+struct BenchIdleStats {
+    int wakeups;  // 空闲等待结束的次数
+    int frames;   // 动画帧数
+    float hideMs; // 从决定隐藏到动画静止的时间
+};
+
+// 单个通道在一次过渡动画中的轨迹质量
+struct BenchLaneStats {
+    bool animated;      // 该方向上有弹簧或缓动曲线；否则直接跳到目标，其余各项没有意义
+    float settleTime;   // 最后一次位置变化的时刻 (秒)
+    float overshoot;    // 越过目标的最大幅度 (通道单位)
+    int renderUpdates;  // 按 RenderQuantize 量化后的渲染值发生变化的帧数，即需要调用 WinAPI 的次数
+    int lastRender;
+};
+
+// 弹簧参数搜索 (/tune)：在对数分布的 tension 与线性分布的阻尼比网格上逐一评估
+#define TUNE_TENSION_MIN   1.0
+#define TUNE_TENSION_MAX   2000.0
+#define TUNE_TENSION_STEPS 96
+#define TUNE_ZETA_MIN      0.3
+#define TUNE_ZETA_MAX      1.5
+#define TUNE_ZETA_STEPS    48
+#define TUNE_MIN_DURATION  0.8 // 静止时刻不得早于目标时长的该比例，避免换成观感明显更快的曲线
+
+// 帧调度模拟 (/pacing)：在虚拟时钟下以不同刷新率的模拟显示器运行过渡动画
+const int PACING_REFRESH_HZ[] = { 60, 144, 240 };
+const int PACING_REFRESH_COUNT = (int)(sizeof(PACING_REFRESH_HZ) / sizeof(PACING_REFRESH_HZ[0]));
+
+struct PacingStats {
+    int frames;      // 提交的帧数
+    int wakeups;     // 跳过刷新周期时的定时器醒来次数
+    int coarseSteps; // 相邻两帧间某个通道的量化值变化超过 1 的帧数
+    float avgFps;
+    float minGapMs;  // 相邻两帧的间隔范围
+    float maxGapMs;
+};
+
+struct TuneResult {
+    SpringParams spring;
+    float settleMs;     // 渲染值最后一次变化的时刻
+    float overshootPct; // 过冲占行程的百分比
+    int frames;         // 到达渲染静止所需的帧数
+    int renderUpdates;  // 需要调用 WinAPI 的帧数
+};
+
+// 弹簧组通道：所有动画量按 SoA 布局存放，一次推进全部通道
+#define BANK_LANES 4 // 与 SSE 宽度一致，空闲通道预留给后续的多显示器/多窗口
+
+enum BankLane {
+    LANE_Y = 0,     // 图标纵向位置 (像素)
+    LANE_ALPHA = 1, // 图标透明度 (0~255)
+    LANE_MASK = 2   // 蒙版透明度 (0~maxMaskAlpha)，跟随透明度或位置通道
+};
+
+struct alignas(16) SpringBank {
+    float pos[BANK_LANES];
+    float vel[BANK_LANES];
+    float prev[BANK_LANES];       // 上一物理步的位置，用于渲染插值
+    float target[BANK_LANES];
+    float startPos[BANK_LANES];   // 段起点相对目标的位移
+    float startVel[BANK_LANES];   // 段起点速度
+    float elapsed[BANK_LANES];    // 段内经过的时间 (秒)
+    float settleTime[BANK_LANES]; // 预测的静止时刻 (秒)，此后渲染值不再变化，直接吸附到目标
+    float lo[BANK_LANES];         // 渲染前的取值范围 (透明度类通道需要钳制)
+    float hi[BANK_LANES];
+    const SpringParams* spring[BANK_LANES]; // 当前段使用的弹簧 (NULL 表示需要重新起段)
+    const SpringCurve* curve[BANK_LANES];   // NULL 表示直接吸附到目标
+#ifdef SPRING_FIXED_POINT
+    // 定点副本：段参数在起段时由浮点字段换算，推进时只读写这些整数，浮点字段作为结果镜像
+    int qPos[BANK_LANES];
+    int qPrev[BANK_LANES];
+    int qTarget[BANK_LANES];
+    int qStartPos[BANK_LANES];
+    int qStartVel[BANK_LANES];
+    int qLo[BANK_LANES];
+    int qHi[BANK_LANES];
+    int elapsedUs[BANK_LANES];
+    int settleUs[BANK_LANES];
+#endif
+};
+
+// 时钟与等待接口：默认为系统实现 (REAL_CLOCK)，模拟运行时切换为虚拟时钟 (VIRTUAL_CLOCK)，
+// 在不实际等待的情况下推进数小时的状态机
+struct Clock {
+    ULONGLONG (*tickMs)();                              // 毫秒时基，对应 GetTickCount64
+    LONGLONG (*counter)();                              // 高精度计数，对应 QueryPerformanceCounter
+    LONGLONG (*frequency)();
+    void (*wait)(DWORD ms);                             // 等待消息或截止时刻
+    void (*waitUntil)(LONGLONG counter);                // 高精度等待到指定计数，不被消息打断
+    void (*vsync)();                                    // 等待垂直同步
+    bool (*vblankTiming)(LONGLONG* vblank, LONGLONG* period); // 最近一次垂直同步的计数与周期
+};
+
+// 虚拟时钟的状态与统计
+#define VIRTUAL_VBLANK_US 16667 // 虚拟时钟默认的垂直同步周期 (60 Hz)
+
+struct VirtualClockState {
+    LONGLONG nowUs;
+    LONGLONG vblankUs; // 模拟显示器的刷新周期
+    int wakeups; // 空闲等待结束的次数
+    int vsyncs;  // 垂直同步等待的次数，即动画帧数
+};
+
+// 性能计数器：统计各线程醒来次数与下列 Win32 函数的每一处调用。
+// 每个线程独占一个按缓存行对齐的计数块，计数时只做本线程内的自增，读取时再汇总
+enum PerfCounterId {
+    PC_WAKEUP,          // 空闲等待结束 (逻辑线程与渲染线程)
+    PC_DWMFLUSH,
+    PC_SETWINDOWPOS,
+    PC_SETLAYERED,      // SetLayeredWindowAttributes
+    PC_ENFORCEZORDER,
+    PC_WINDOWFROMPOINT,
+    PC_FINDWINDOW,      // FindWindow 与 FindWindowEx
+    PC_HTTP_REQUEST,    // 更新检测的网络请求 (后台线程)
+    PC_COUNT
+};
+
+const TCHAR* PERF_COUNTER_NAMES[PC_COUNT] = {
+    _T("wakeup"), _T("DwmFlush"), _T("SetWindowPos"), _T("SetLayeredWindowAttributes"),
+    _T("EnforceZOrder"), _T("WindowFromPoint"), _T("FindWindow"), _T("InternetOpenUrl")
+};
+
+#define PERF_MAX_THREADS 16 // 超出的线程共用最后一块，改用原子自增，导出时该列标为共用
+#define CACHE_LINE_SIZE  64 // 不同线程写入的数据按缓存行分块，避免伪共享
+
+struct alignas(CACHE_LINE_SIZE) PerfCounterBlock {
+    std::atomic<LONG> counts[PC_COUNT]; // 宽松序读写，只为让跨线程汇总可被 ThreadSanitizer 检查
+    std::atomic<const TCHAR*> thread;   // 导出时的列名，NULL 表示未命名
+};
+
+// 帧记录：渲染线程每帧写入一条，固定容量循环覆盖，不分配内存。
+// 文件格式为 FlightFileHeader 后接 count 条 FlightFrame (小端、从旧到新)，Tools/FlightAnalyzer.cpp 按同样的布局读取
+enum FlightSaveReason { FLIGHT_REASON_MANUAL, FLIGHT_REASON_HITCH };
+
+struct FlightFrame {
+    DWORD frame;         // 自启动以来的帧序号
+    DWORD intervalUs;    // 距上一帧开始的时长，动画的第一帧为 0
+    DWORD dtUs;          // 本帧推进的动画时长
+    DWORD applyUs;       // 提交上一帧 (ApplyAnimation)
+    DWORD physicsUs;     // 帧调度与物理推进
+    DWORD waitUs;        // 等待垂直同步 (含跳过周期时的定时器等待)
+    LONG lateUs;         // 醒来时刻晚于计划垂直同步的时长，取不到合成计时信息时为 0
+    BYTE setWindowPos;   // 本帧的 Win32 调用次数 (封顶 255)
+    BYTE setLayered;
+    BYTE enforceZOrder;
+    BYTE timerWaits;
+};
+static_assert(sizeof(FlightFrame) == 32, "FlightFrame 是文件格式的一部分");
+
+struct FlightFileHeader {
+    DWORD magic;         // FLIGHT_MAGIC
+    WORD version;        // FLIGHT_VERSION
+    WORD frameSize;      // sizeof(FlightFrame)
+    DWORD count;
+    DWORD periodUs;      // 刷新周期，0 表示未知
+    DWORD reason;        // FlightSaveReason
+    DWORD profile;       // 预设序号
+    DWORD capFps;        // 帧率上限，0 表示不限
+    DWORD hitchMs;       // FLIGHT_HITCH_MS
+};
+static_assert(sizeof(FlightFileHeader) == 32, "FlightFileHeader 是文件格式的一部分");
+
+struct alignas(CACHE_LINE_SIZE) FlightRecorder {
+    FlightFrame frames[FLIGHT_FRAMES];
+    DWORD count;             // 累计帧数，下一帧写入 frames[count % FLIGHT_FRAMES]
+    LONGLONG lastStart;      // 上一帧开始的计数，0 表示动画刚开始
+    LONG calls[PC_COUNT];    // 帧开始时本线程的计数
+    bool hitch;              // 本段动画出现过卡顿
+    ULONGLONG lastAutoSave;
+};
+
+// 帧调度：刷新周期与垂直同步相位只在动画开始时查询一次，显示设置变化后重新查询。
+// 设有帧率上限时按理想间隔挑选最接近的垂直同步提交，中间跳过的周期用高精度定时器睡过去
+struct FramePacer {
+    LONGLONG vblank;   // 参考垂直同步时刻 (计数)
+    LONGLONG period;   // 刷新周期，0 表示取不到合成计时信息
+    bool timingValid;
+    LONGLONG nextDue;  // 帧率上限下一帧的理想提交时刻，0 表示动画刚开始
+    LONGLONG target;   // 本帧等待的垂直同步，0 表示直接等待下一次
+    LONGLONG synced;   // 上一帧等待垂直同步返回的时刻，0 表示动画刚开始
+    bool fixedRate;    // 关闭尾段降频，只用于对比测试
+};
+
+// 单生产者/单消费者三缓冲：生产者总有一块独占的槽位可写，消费者总能取到最近一次发布的完整数据。
+// 双方只交换一个原子索引，互不等待，也不会读到写了一半的数据；消费者来不及取走的旧版本直接被覆盖。
+// 槽位与两端的序号各占独立的缓存行，双方只在交换 middle 时争用同一行 (ALIGN 只在基准中改小，对比紧凑布局)。
+// 只依赖 <atomic>，不含平台相关代码
+template <typename T, size_t ALIGN = CACHE_LINE_SIZE>
+struct TripleBuffer {
+    static const unsigned FRESH = 4; // middle 中的标志位：自上次取走后有新发布
+    struct alignas(ALIGN) Slot { T value; };
+
+    Slot slots[3];
+    alignas(ALIGN) std::atomic<unsigned> middle; // 交接槽位的序号 | FRESH
+    alignas(ALIGN) unsigned writeIndex;          // 生产者独占
+    alignas(ALIGN) unsigned readIndex;           // 消费者独占
+
+    TripleBuffer() : middle(1), writeIndex(0), readIndex(2) {}
+
+    // 生产者：填写 Write() 返回的槽位后发布，发布后换到另一块槽位继续写
+    T& Write() { return slots[writeIndex].value; }
+    void Publish() { writeIndex = middle.exchange(writeIndex | FRESH, std::memory_order_acq_rel) & 3; }
+
+    // 消费者：有新发布时换入最新的槽位，返回是否有更新。Read() 在下一次 Consume 之前保持不变
+    bool Consume() {
+        if (!(middle.load(std::memory_order_relaxed) & FRESH)) return false;
+        readIndex = middle.exchange(readIndex, std::memory_order_acq_rel) & 3;
+        return true;
+    }
+    const T& Read() const { return slots[readIndex].value; }
+};
+
+// 有界多生产者/单消费者队列：每个格子带一个序号，生产者用 CAS 领取写入位置，写完后推进格子的序号交给消费者。
+// 同一生产者的命令按提交顺序出队；队列满时 Push 返回 false，不阻塞。N 须为 2 的幂。只依赖 <atomic>
+template <typename T, unsigned N>
+struct CommandQueue {
+    struct Cell {
+        std::atomic<unsigned> seq; // 等于写入位置时可写，等于位置 + 1 时可读
+        T value;
+    };
+
+    Cell cells[N];
+    alignas(CACHE_LINE_SIZE) std::atomic<unsigned> tail; // 生产者之间争用
+    alignas(CACHE_LINE_SIZE) unsigned head;              // 消费者独占
+
+    CommandQueue() : tail(0), head(0) {
+        for (unsigned i = 0; i < N; i++) cells[i].seq.store(i, std::memory_order_relaxed);
+    }
+
+    bool Push(const T& v) {
+        unsigned pos = tail.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& c = cells[pos & (N - 1)];
+            int diff = (int)(c.seq.load(std::memory_order_acquire) - pos);
+            if (diff == 0) {
+                if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    c.value = v;
+                    c.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0) {
+                return false; // 满：消费者还没取走 N 个位置之前的命令
+            }
+            else {
+                pos = tail.load(std::memory_order_relaxed); // 被其他生产者抢先
+            }
+        }
+    }
+
+    bool Pop(T& out) {
+        Cell& c = cells[head & (N - 1)];
+        if ((int)(c.seq.load(std::memory_order_acquire) - (head + 1)) < 0) return false;
+        out = c.value;
+        c.seq.store(head + N, std::memory_order_release);
+        head++;
+        return true;
+    }
+};
+
+// 跨线程的锁。定义 LOCK_STATS 时 (压力测试) 换成 StatMutex，记录持有的次数、总时长与最长一次，
+// 条件变量相应换成 condition_variable_any，在等待中释放锁时同样计时；默认就是 std::mutex
+#ifdef LOCK_STATS
+struct StatMutex {
+    std::mutex m;
+    std::chrono::steady_clock::time_point since; // 只在持有时读写
+    std::atomic<long long> holds;
+    std::atomic<long long> totalNs;
+    std::atomic<long long> maxNs;
+
+    StatMutex() : holds(0), totalNs(0), maxNs(0) {}
+
+    void lock() {
+        m.lock();
+        since = std::chrono::steady_clock::now();
+    }
+
+    bool try_lock() {
+        if (!m.try_lock()) return false;
+        since = std::chrono::steady_clock::now();
+        return true;
+    }
+
+    void unlock() {
+        long long ns = (long long)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - since).count();
+        holds.fetch_add(1, std::memory_order_relaxed);
+        totalNs.fetch_add(ns, std::memory_order_relaxed);
+        long long seen = maxNs.load(std::memory_order_relaxed);
+        while (ns > seen && !maxNs.compare_exchange_weak(seen, ns, std::memory_order_relaxed)) {}
+        m.unlock();
+    }
+};
+typedef StatMutex Mutex;
+typedef std::condition_variable_any ConditionVariable;
+#else
+typedef std::mutex Mutex;
+typedef std::condition_variable ConditionVariable;
+#endif
+
+// 自动复位的唤醒信号 (等同于自动复位事件)：Notify 可在任意线程、任意时刻调用，Wait 之前的多次通知合并为一次。
+// 只依赖标准库，锁只在置位/清除标志时持有
+struct WakeSignal {
+    Mutex m;
+    ConditionVariable cv;
+    bool set;
+
+    WakeSignal() : set(false) {}
+
+    void Notify() {
+        {
+            std::lock_guard<Mutex> hold(m);
+            set = true;
+        }
+        cv.notify_one();
+    }
+
+    void Wait() {
+        std::unique_lock<Mutex> hold(m);
+        while (!set) cv.wait(hold);
+        set = false;
+    }
+};
+
+// 后台任务池：少量常驻线程执行可能阻塞的后台工作 (网络检测、延迟的通知)，代替每次临时创建线程。
+// 到期的任务按 (优先级, 提交顺序) 执行；低优先级任务最多同时占用 TASK_POOL_THREADS - 1 个线程，
+// 高优先级任务不会排在长时间阻塞的网络请求之后。容量固定，不分配内存，满时 Submit 返回 false。只依赖标准库
+typedef void (*TaskProc)(int arg0, int arg1);
+
+enum TaskPriority { TASK_PRIORITY_LOW, TASK_PRIORITY_HIGH };
+
+struct BackgroundTask {
+    TaskProc run;
+    int arg0;
+    int arg1;
+    int priority;
+    unsigned seq;                             // 提交顺序，同优先级先到先执行
+    std::chrono::steady_clock::time_point due;
+};
+
+struct TaskPool {
+    BackgroundTask tasks[TASK_POOL_CAPACITY]; // 未开始的任务，无序
+    int count;
+    unsigned nextSeq;
+    int runningLow;                           // 正在执行的低优先级任务数
+    bool started;
+    bool quit;
+    Mutex m;
+    ConditionVariable work;             // 有新任务，或低优先级的配额空出
+    std::thread workers[TASK_POOL_THREADS];
+
+    TaskPool() : count(0), nextSeq(0), runningLow(0), started(false), quit(false) {}
+
+    bool Start() {
+        std::lock_guard<Mutex> hold(m);
+        for (int i = 0; i < TASK_POOL_THREADS; i++) {
+            try {
+                workers[i] = std::thread(&TaskPool::WorkerLoop, this);
+                started = true;
+            }
+            catch (const std::system_error&) {
+                break; // 已创建的线程照常工作
+            }
+        }
+        return started;
+    }
+
+    // 提交任务，delayMs 毫秒后到期。未启动、正在退出或已满时返回 false，由调用方就地处理
+    bool Submit(TaskProc run, int arg0, int arg1, int priority, DWORD delayMs) {
+        {
+            std::lock_guard<Mutex> hold(m);
+            if (!started || quit || count == TASK_POOL_CAPACITY) return false;
+            BackgroundTask& t = tasks[count++];
+            t.run = run;
+            t.arg0 = arg0;
+            t.arg1 = arg1;
+            t.priority = priority;
+            t.seq = nextSeq++;
+            t.due = std::chrono::steady_clock::now() + std::chrono::milliseconds(delayMs);
+        }
+        work.notify_one();
+        return true;
+    }
+
+    // 撤销所有尚未开始的同类任务，返回撤销的个数。已开始的任务不受影响
+    int Cancel(TaskProc run) {
+        std::lock_guard<Mutex> hold(m);
+        int removed = 0;
+        for (int i = 0; i < count; ) {
+            if (tasks[i].run == run) { tasks[i] = tasks[--count]; removed++; }
+            else i++;
+        }
+        return removed;
+    }
+
+    // 丢弃排队的任务，等正在执行的任务结束后让线程退出。
+    // 可能长时间阻塞的任务须先由其所有者中止 (如 CancelUpdateChecks)，此后不再有线程访问全局状态
+    void Stop() {
+        {
+            std::lock_guard<Mutex> hold(m);
+            quit = true;
+            count = 0;
+        }
+        work.notify_all();
+        for (int i = 0; i < TASK_POOL_THREADS; i++) {
+            if (workers[i].joinable()) workers[i].join();
+        }
+    }
+
+    // 取一个可以开始的任务：已到期，且低优先级任务未超出配额。没有时给出最早的到期时刻 (没有待到期的任务时为 max)
+    int PickLocked(std::chrono::steady_clock::time_point now, std::chrono::steady_clock::time_point& nextDue) {
+        int best = -1;
+        nextDue = std::chrono::steady_clock::time_point::max();
+        for (int i = 0; i < count; i++) {
+            const BackgroundTask& t = tasks[i];
+            if (t.due > now) {
+                if (t.due < nextDue) nextDue = t.due;
+                continue;
+            }
+            if (t.priority == TASK_PRIORITY_LOW && runningLow >= TASK_POOL_THREADS - 1) continue;
+            if (best < 0 || t.priority > tasks[best].priority ||
+                (t.priority == tasks[best].priority && (int)(t.seq - tasks[best].seq) < 0)) best = i;
+        }
+        return best;
+    }
+
+    void WorkerLoop() {
+        std::unique_lock<Mutex> hold(m);
+        while (!quit) {
+            std::chrono::steady_clock::time_point nextDue;
+            int i = PickLocked(std::chrono::steady_clock::now(), nextDue);
+            if (i < 0) {
+                if (nextDue == std::chrono::steady_clock::time_point::max()) work.wait(hold);
+                else work.wait_until(hold, nextDue);
+                continue;
+            }
+
+            BackgroundTask t = tasks[i];
+            tasks[i] = tasks[--count];
+            bool low = (t.priority == TASK_PRIORITY_LOW);
+            if (low) runningLow++;
+
+            hold.unlock();
+            t.run(t.arg0, t.arg1);
+            hold.lock();
+
+            if (low) {
+                runningLow--;
+                work.notify_one(); // 可能有低优先级任务在等配额
+            }
+        }
+    }
+};
+
+// 动画目标快照：逻辑线程 (主线程) 在目标或配置变化时整体发布，渲染线程只读。
+// 一次性请求以递增的序号表示，中间版本被覆盖时请求也不会丢失
+struct AnimSnapshot {
+    DWORD seq;            // 发布序号
+    const ConfigProfile* cfg;
+    float targetY;
+    float targetAlpha;
+    bool isHidden;
+    bool accelerated;     // 启动/切换流程中，动画按 STARTUP_SPEED_FACTOR 推进
+    bool quit;            // 渲染线程退出
+    int maxMaskAlpha;
+    int screenW;
+    int screenH;
+    int frameCapIndex;
+    HWND hContainer;
+    HWND hMaskWindow;
+    DWORD jumpSeq;        // 变化时把位置与透明度直接置为 jumpY/jumpAlpha，丢弃当前动画段
+    float jumpY;
+    float jumpAlpha;
+    DWORD resyncSeq;      // 变化时清空渲染缓存并立即提交一次 (窗口重建、强制显示)
+    DWORD displaySeq;     // 变化时重新查询刷新率
+    DWORD flightSaveSeq;  // 变化时保存帧记录
+};
+
+// 发给逻辑线程 (主线程) 的命令，由主循环在每次迭代开始时按顺序执行。
+// 每种命令都只设定一项状态或请求一次可合并的动作，同类命令后到的可以取代先到的，队列满时据此合并而不丢弃
+enum LogicCommandType {
+    CMD_SET_PROFILE,     // arg: 预设序号
+    CMD_SET_MASK,        // arg: 蒙版选项序号
+    CMD_SET_FRAME_CAP,   // arg: 帧率上限选项序号
+    CMD_SHOW,            // 托盘图标上的操作视同桌面活动：以动画转入显示
+    CMD_SET_PAUSED,      // arg: 1 会话锁定，0 会话解锁
+    CMD_DISPLAY_RESET,   // 显示设置变化或任务栏重启：重新定位桌面并重新查询刷新率
+    CMD_SAVE_FRAME_LOG,
+    CMD_COUNT
+};
+
+struct LogicCommand {
+    int type;  // LogicCommandType
+    int arg;
+};
+
+// 队列满时的合并格：每种命令一格，只保留最新的参数。在队列中的同类命令之后执行
+struct CommandOverflow {
+    std::atomic<bool> set;
+    std::atomic<int> arg;
+};
+
+// 渲染线程发布的状态，逻辑线程据此判断动画是否结束
+struct RenderStatus {
+    DWORD seq;   // 已应用的快照序号
+    bool idle;   // 该快照下的动画已静止
+    float y;     // 当前位置与透明度 (未量化)
+    float alpha;
+};
+
+// 按配置形态特化的物理例程，配置切换时经 PHYSICS_ROUTINES 表选择
+struct PhysicsRoutines {
+    float (*stepSize)();
+    void (*step)(float dt);
+    bool (*idle)();
+};
+
 // 全局上下文结构
-struct GlobalState {
+// 主线程 (逻辑线程) 独占的状态。按访问频率排列：主循环每次迭代读写的字段在前，
+// 配置与窗口句柄只在切换时写入，放在后面
+struct alignas(CACHE_LINE_SIZE) GlobalState {
+    // 交互状态
+    POINT lastMousePos;
+    ULONGLONG lastActiveTime;
+    bool isHidden;
+    bool rawInputActive;   // 已隐藏时由原始鼠标输入唤醒主循环
+    ULONGLONG rawInputWakeTime; // 最近一次在注册了原始输入时醒来的时刻，用于限流
+
+    // 动画目标
+    float targetY;
+    float targetAlpha;
+
+    // 状态机
+    int startupState; // 0:Hiding, 1:Waiting, 2:Showing, 3:Normal
+    ULONGLONG waitStartTime;
+    ULONGLONG startupPhaseStartTime;
+
+    // 发给渲染线程的请求与最近一次发布的快照
+    DWORD jumpSeq;
+    float jumpY;
+    float jumpAlpha;
+    DWORD resyncSeq;
+    DWORD displaySeq;
+    DWORD flightSaveSeq;
+    bool renderQuit;
+    AnimSnapshot published;
+
     // 窗口句柄
     HWND hContainer;
     HWND hDesktopParent;
-    HWND hMsgWindow;
+    HWND hMsgWindow;       // 创建后不再改变，后台线程只用它投递消息
     HWND hMaskWindow;
+    HANDLE hWakeTimer;     // 空闲等待的截止时刻
 
     // 屏幕尺寸
     int screenW;
@@ -146,53 +855,87 @@ struct GlobalState {
     int cfgIndex;
     int maskOptIndex;
     int maxMaskAlpha;
+    int frameCapIndex;
+
+} g = { 0 };
+
+// 进程级的运行标志：由消息处理写入，任何线程都可能读取
+struct alignas(CACHE_LINE_SIZE) SharedFlags {
+    std::atomic<bool> appRunning;
+    std::atomic<bool> isPaused;
+} g_Flags;
 
-    // 待处理配置
-    int pendingCfgIndex;
-    bool hasPendingCfg;
-    int pendingMaskOptIndex;
-    bool hasPendingMask;
+// 安装路径：启动时确定，只在安装/卸载流程中使用
+struct InstallPaths {
+    TCHAR szInstallDir[MAX_PATH];
+    TCHAR szInstallExePath[MAX_PATH];
+} g_Paths = { 0 };
+
+// 渲染线程独占的状态：弹簧组、帧调度与已提交的渲染值。逻辑线程只经快照与状态两个三缓冲与之通信；
+// 基准测试在单线程中依次调用两侧的函数
+struct alignas(CACHE_LINE_SIZE) RenderContext {
+    AnimSnapshot view;                // 最近一次取到的快照
+    const PhysicsRoutines* physics;   // 与 view.cfg 同步切换
+    DWORD jumpSeq;                    // 已处理的请求序号
+    DWORD resyncSeq;
+    DWORD displaySeq;
+    DWORD flightSaveSeq;
 
     // 物理状态
-    float currentY, velocityY;
-    float currentAlpha, velocityAlpha;
-    float targetY;
-    float targetAlpha;
+    SpringBank bank;
+    LONGLONG physicsAccumulatorUs; // 尚未消耗的帧时间 (微秒)
+    LARGE_INTEGER qpcFreq;      // 帧计时基准 (TimerGetDelta / TimerAdvanceTo)
+    LARGE_INTEGER qpcLastTime;
+
+    // 流水线帧：在等待垂直同步期间预先算好的下一帧，垂直同步后立即提交
+    float frameRender[BANK_LANES];
+    bool framePending;
+    FramePacer pacer;
 
     // 渲染缓存
     int lastRenderY;
     int lastRenderAlpha;
     int lastMaskAlpha;
-
-    // 状态机
-    int startupState; // 0:Hiding, 1:Waiting, 2:Showing, 3:Normal
-    ULONGLONG waitStartTime;
-    ULONGLONG startupPhaseStartTime;
     int zOrderGuardCounter;
 
-    // 交互状态
-    POINT lastMousePos;
-    ULONGLONG lastActiveTime;
-    bool isHidden;
-    bool appRunning;
-    bool isPaused;
+    std::thread thread;
+    WakeSignal wake;       // 逻辑线程发布快照后通知
+    HANDLE hFrameTimer;    // 帧率上限下跳过刷新周期时的高精度定时器
+} g_Render;
 
-    // 路径
-    TCHAR szInstallDir[MAX_PATH];
-    TCHAR szInstallExePath[MAX_PATH];
-} g = { 0 };
+TripleBuffer<AnimSnapshot> g_AnimSnapshots; // 逻辑线程 → 渲染线程
+TripleBuffer<RenderStatus> g_RenderStatus;  // 渲染线程 → 逻辑线程
+FlightRecorder g_Flight;                    // 渲染线程独占
+CommandQueue<LogicCommand, LOGIC_QUEUE_SIZE> g_Commands; // 任意线程 → 逻辑线程
+CommandOverflow g_CommandOverflow[CMD_COUNT];            // 队列满时代替 g_Commands
+TaskPool g_Tasks;                           // 任意线程提交，后台线程执行
 
+// 更新检测：每轮检测有自己的代号，上一轮尚未超时的线程迟到的结果被丢弃。
+// 界面线程只读 status (与 fastestUrl)，其余字段在 lock 内读写
 struct UpdateContext {
-    volatile UpdateStatus status;
-    TCHAR fastestUrl[512];
-    volatile LONG activeThreads;
-    HMENU hActiveMenu;
+    std::atomic<UpdateStatus> status;
+    TCHAR fastestUrl[512];     // 在状态变为 US_UPDATE_FOUND 之前写入，之后不再改变
+    int generation;            // 当前一轮的代号
+    int pending;               // 本轮尚未返回结果的镜像数
+    HINTERNET sessions[TASK_POOL_THREADS]; // 正在进行的检测的会话，退出时关闭以中止阻塞中的请求
+    bool closing;              // 正在退出，不再开始新的请求
+    Mutex lock;
+    HMENU hActiveMenu;         // 仅界面线程使用
     bool hasCheckStarted;
-} g_UpdateCtx = { US_IDLE, {0}, 0, NULL, false };
+} g_UpdateCtx;
+
+SpringCurve g_Curves[PRESET_COUNT * 4 + 1]; // 末尾留一个槽位给 /tune 的候选曲线
+int g_CurveCount = 0;
 
 NOTIFYICONDATA nid = { 0 };
-LARGE_INTEGER qpcFreq;
-LARGE_INTEGER qpcLastTime;
+extern const Clock REAL_CLOCK;
+extern const Clock VIRTUAL_CLOCK;
+const Clock* g_Clock = &REAL_CLOCK;
+VirtualClockState g_VirtualClock = { 0 };
+PerfCounterBlock g_PerfBlocks[PERF_MAX_THREADS];
+std::atomic<LONG> g_PerfBlockCount(0);
+__declspec(thread) PerfCounterBlock* t_PerfBlock = NULL;
+ULONGLONG g_PerfStartTick = 0;
 UINT g_uMsgTaskbarCreated = 0;
 const int MOUSE_MOVE_THRESHOLD = 2;
 
@@ -200,8 +943,40 @@ const int MOUSE_MOVE_THRESHOLD = 2;
 // === 函数前置声明 (Declaration) ===
 // ==========================================
 
+ULONGLONG RealTickMs();
+LONGLONG RealCounter();
+LONGLONG RealFrequency();
+void RealWait(DWORD ms);
+void RealWaitUntil(LONGLONG counter);
+void RealVSync();
+bool RealVBlankTiming(LONGLONG* vblank, LONGLONG* period);
+ULONGLONG VirtualTickMs();
+LONGLONG VirtualCounter();
+LONGLONG VirtualFrequency();
+void VirtualWait(DWORD ms);
+void VirtualWaitUntil(LONGLONG counter);
+void VirtualVSync();
+bool VirtualVBlankTiming(LONGLONG* vblank, LONGLONG* period);
+void UseVirtualClock(bool enable);
+PerfCounterBlock* PerfAttachThread();
+void PerfCount(int id);
+void PerfNameThread(const TCHAR* name);
+void PerfCollect(LONGLONG* totals);
+void UpdateTrayTooltip();
+int ExportPerfCounters();
 void TimerInit();
 float TimerGetDelta(bool resetOnly = false);
+float TimerAdvanceTo(LONGLONG targetQpc);
+LONGLONG PredictNextVBlank(LONGLONG now, LONGLONG lastVBlank, LONGLONG period);
+void RefreshDisplayTiming();
+LONGLONG FrameCapInterval();
+LONGLONG StretchFrameTarget(LONGLONG target);
+LONGLONG PlanFrame();
+void WaitForFrame();
+void EndFramePacing();
+void SetRawMouseInput(bool enable);
+DWORD PlanIdleWait(ULONGLONG now, bool wasMoving, bool* wantRawInput);
+void WaitForWork(DWORD ms);
 void InitGlobalPaths();
 
 bool IsRunAsAdministrator();
@@ -227,27 +1002,88 @@ void PerformExitSequence();
 
 BOOL CALLBACK FindSysListViewProc(HWND hwnd, LPARAM lParam);
 void EnableLayeredStyle(HWND hwnd, bool enable);
-void EnforceZOrder();
+void EnforceZOrder(HWND hContainer, HWND hMask);
 void CreateMaskWindow(HINSTANCE hInstance);
+void DestroyMaskWindow();
 void AttachMaskToDesktop();
 void LocateDesktop(HINSTANCE hInstance);
 void InitTrayIcon(HWND hwnd);
 void CreateMessageWindow(HINSTANCE hInstance);
 
 void SolveSpring(float& current, float& velocity, float target, const SpringParams& p, float dt);
+double SpringDecayRate(const SpringParams& p);
+void BakeSpringCurve(SpringCurve& c, const SpringParams& p);
+void BakeSpringCurves();
+const SpringCurve* FindSpringCurve(const SpringParams& p);
+int RenderQuantize(float v);
+int FixedFromFloat(double v, int shift);
+float BankSettleTime(const SpringBank& b, int lane);
+float BankValueAt(const SpringBank& b, int lane, float t);
+void BankSet(SpringBank& b, int lane, float value);
+void BankRetarget(SpringBank& b, int lane, float target, const SpringParams& p);
+void BankFollow(SpringBank& b, int lane, int src, float gain, float offset);
+#ifdef SPRING_FIXED_POINT
+void BankSyncFixed(SpringBank& b, int lane);
+#endif
+void BankStep(SpringBank& b, float dt);
+float ActivePhysicsStep();
+LONGLONG ActivePhysicsStepUs();
+void StepPhysics(float dt);
+void AdvancePhysics(float dt, float* render);
 void UpdatePhysics(float dt);
+void ApplyAnimation(float y, float alpha, float maskAlpha);
+bool IsChannelIdle(int lane, float target, const SpringParams& p);
 bool IsPhysicsIdle();
+void SelectPhysicsRoutines();
+float PhysicsTimeToSettle();
+bool ParseToolCommand(const TCHAR* cmdLine, const TCHAR* mode, float* args, int argCount, TCHAR* outPath, size_t cchPath);
+void BenchInit();
+FILE* OpenBenchOutput(const TCHAR* outPath, const TCHAR* defaultName, TCHAR* szPath, size_t cchPath);
+void BenchResetTransition(const ConfigProfile& profile, bool hide);
+int BenchTransition(const ConfigProfile& profile, bool hide, BenchLaneStats* stats);
+void BenchIdleHour(const ConfigProfile& profile, BenchIdleStats* stats);
+int RunPhysicsBenchmark(const TCHAR* outPath);
+bool TuneChannel(int lane, float durationMs, float overshootPct, TuneResult& best);
+int RunSpringTuner(float durationMs, float overshootPct, const TCHAR* outPath);
+void PacingTransition(const ConfigProfile& profile, bool hide, int refreshHz, bool fixedRate, PacingStats* stats);
+int RunPacingSimulation(const TCHAR* outPath);
+void LogicTick(HINSTANCE hInstance, ULONGLONG now, bool isMoving);
+void UpdateActivity(ULONGLONG now, bool isMoving);
+void PublishAnimSnapshot();
+const RenderStatus& LatestRenderStatus();
+bool RenderIdle();
+bool RenderSync();
+void PublishRenderStatus(bool idle);
+void RenderThreadProc();
+void RaiseThreadPriority(std::thread& t);
+void JoinThreadPumpingMessages(std::thread& t);
+bool StartRenderThread();
+void StopRenderThread();
+void WaitRenderSnapshotConsumed();
+void FlightRecordPath(TCHAR* szPath, size_t cchPath);
+LONG PerfThreadCount(int id);
+void FlightBeginFrame();
+void FlightEndFrame(LONGLONG start, LONGLONG applied, LONGLONG computed, float dt);
+void FlightEndAnimation();
+bool FlightSave(int reason);
 void ForceShowImmediate();
-void TriggerRestartAnimation();
+void ApplySettings(HINSTANCE hInstance, bool reattachMask);
+void HotSwapSettings();
 bool IsMouseOnDesktop();
 
 int ParseVersionFromUrl(const TCHAR* url);
 bool CheckSingleUrl(const TCHAR* url, HINTERNET hSession, int& outVersion, TCHAR* outFinalUrl, size_t bufferSize);
-DWORD WINAPI CheckUpdateThreadProc(LPVOID lpParam);
+void UpdateCheckFinished(int generation, int ver, const TCHAR* finalUrl);
+void CheckUpdateTask(int mirror, int generation);
 void StartUpdateChecks();
+void CancelUpdateChecks();
 void RefreshMenuText();
 void ShowTrayMenu(HWND hwnd);
 
+void PostLogicCommand(int type, int arg = 0);
+void RunLogicCommands();
+void ExecuteLogicCommand(const LogicCommand& c);
+void DisplayResetTask(int arg0, int arg1);
 LRESULT CALLBACK MsgWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam);
 
 // ==========================================
@@ -266,6 +1102,27 @@ int APIENTRY wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPWSTR lpCmd
         return 0;
     }
 
+    // 命令行工具：无需安装，不创建任何窗口
+    if (lpCmdLine) {
+        TCHAR outPath[MAX_PATH];
+        float args[2];
+
+        // 物理基准测试：/bench [输出文件]
+        if (ParseToolCommand(lpCmdLine, _T("/bench"), NULL, 0, outPath, _countof(outPath))) return RunPhysicsBenchmark(outPath);
+
+        // 弹簧参数搜索：/tune 时长毫秒 过冲百分比 [输出文件]
+        if (ParseToolCommand(lpCmdLine, _T("/tune"), args, 2, outPath, _countof(outPath))) {
+            if (args[0] <= 0.0f || args[1] < 0.0f) {
+                MessageBox(NULL, _T("用法：AutoICON.exe /tune 时长毫秒 过冲百分比 [输出文件]"), APP_NAME, MB_OK | MB_ICONINFORMATION);
+                return 1;
+            }
+            return RunSpringTuner(args[0], args[1], outPath);
+        }
+
+        // 帧调度模拟：/pacing [输出文件]
+        if (ParseToolCommand(lpCmdLine, _T("/pacing"), NULL, 0, outPath, _countof(outPath))) return RunPacingSimulation(outPath);
+    }
+
     // 安装/更新检查
     HandleInstallation();
 
@@ -273,7 +1130,7 @@ int APIENTRY wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPWSTR lpCmd
     TCHAR currentPath[MAX_PATH];
     GetModuleFileName(NULL, currentPath, MAX_PATH);
     // 简单的路径对比可能受大小写影响，这里使用 _tcsnicmp 忽略大小写
-    if (_tcsnicmp(currentPath, g.szInstallDir, _tcslen(g.szInstallDir)) != 0) {
+    if (_tcsnicmp(currentPath, g_Paths.szInstallDir, _tcslen(g_Paths.szInstallDir)) != 0) {
         MessageBox(NULL, _T("程序必须在安装目录运行！"), APP_NAME, MB_OK | MB_ICONERROR);
         return 1;
     }
@@ -283,138 +1140,86 @@ int APIENTRY wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPWSTR lpCmd
     if (GetLastError() == ERROR_ALREADY_EXISTS) return 0;
 
     g_uMsgTaskbarCreated = RegisterWindowMessage(_T("TaskbarCreated"));
-    g.appRunning = true;
-    g.isPaused = false;
+    PerfNameThread(_T("logic"));
+    g_Flags.appRunning = true;
+    g_Flags.isPaused = false;
 
     // 加载配置
     LoadSettings();
-    g.lastActiveTime = GetTickCount64();
+    BakeSpringCurves();
+    g.lastActiveTime = g_Clock->tickMs();
 
     // 初始化窗口和系统组件
     CreateMessageWindow(hInstance);
+    g_Tasks.Start(); // 启动失败时后台工作由提交处就地处理
     WTSRegisterSessionNotification(g.hMsgWindow, NOTIFY_FOR_THIS_SESSION);
     InitTrayIcon(g.hMsgWindow);
     LocateDesktop(hInstance);
     TimerInit();
+    g.hWakeTimer = CreateWaitableTimer(NULL, FALSE, NULL);
+    g_PerfStartTick = g_Clock->tickMs();
 
     if (!g.hContainer) {
         MessageBox(NULL, _T("无法定位桌面窗口。"), APP_NAME, MB_ICONERROR);
-        g.appRunning = false;
+        g_Flags.appRunning = false;
+    }
+    else if (!StartRenderThread()) {
+        MessageBox(NULL, _T("无法创建渲染线程。"), APP_NAME, MB_ICONERROR);
+        g_Flags.appRunning = false;
     }
 
     // 主消息循环
     MSG msg;
-    while (g.appRunning) {
+    while (g_Flags.appRunning) {
         while (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE)) {
-            if (msg.message == WM_QUIT) g.appRunning = false;
+            if (msg.message == WM_QUIT) g_Flags.appRunning = false;
             TranslateMessage(&msg);
             DispatchMessage(&msg);
         }
-        if (!g.appRunning) break;
-        if (g.isPaused) { Sleep(1000); continue; }
+        if (!g_Flags.appRunning) break;
+        RunLogicCommands();
+        if (g_Flags.isPaused) { WaitForWork(INFINITE); continue; } // 解锁时的会话消息会唤醒
 
         // 桌面窗口防丢失机制
         if (!IsWindow(g.hContainer)) {
             LocateDesktop(hInstance);
-            if (!g.hContainer) { Sleep(500); continue; }
+            if (!g.hContainer) { WaitForWork(500); continue; }
         }
 
         // 状态更新逻辑
         POINT currMouse;
         GetCursorPos(&currMouse);
-        ULONGLONG currTime = GetTickCount64();
+        ULONGLONG currTime = g_Clock->tickMs();
         bool isMoving = (abs(currMouse.x - g.lastMousePos.x) > MOUSE_MOVE_THRESHOLD ||
             abs(currMouse.y - g.lastMousePos.y) > MOUSE_MOVE_THRESHOLD);
+        if (g.rawInputActive) g.rawInputWakeTime = currTime;
 
-        // 启动动画状态机
-        if (g.startupState == STARTUP_PHASE_1_HIDING) { // 0: 启动时的隐藏阶段
-            bool hiddenEnough = true;
-            if (g.currentY < g.screenH * 0.9f && g.currentAlpha > 10.0f) hiddenEnough = false;
-            if (hiddenEnough || (currTime - g.startupPhaseStartTime > 2000)) {
-                g.startupState = STARTUP_PHASE_2_WAITING;
-                g.waitStartTime = currTime;
-            }
-        }
-        else if (g.startupState == STARTUP_PHASE_2_WAITING) { // 1: 等待配置切换
-            if (currTime - g.waitStartTime > STARTUP_TRANSITION_DELAY) {
-                if (g.hasPendingCfg) {
-                    g.cfgIndex = g.pendingCfgIndex;
-                    g.hasPendingCfg = false;
-                }
-                if (g.hasPendingMask) {
-                    g.maskOptIndex = g.pendingMaskOptIndex;
-                    g.hasPendingMask = false;
-                }
-
-                // 应用新配置
-                g.cfg = &PRESETS[g.cfgIndex];
-                g.maxMaskAlpha = MASK_OPTIONS[g.maskOptIndex].alpha;
-                SaveSettings();
+        LogicTick(hInstance, currTime, isMoving);
 
-                // 重建遮罩
-                if (g.maxMaskAlpha <= 0) {
-                    if (g.hMaskWindow && IsWindow(g.hMaskWindow)) DestroyWindow(g.hMaskWindow);
-                    g.hMaskWindow = NULL;
-                }
-                else {
-                    if (!g.hMaskWindow || !IsWindow(g.hMaskWindow)) CreateMaskWindow(hInstance);
-                    AttachMaskToDesktop();
-                }
-
-                // 重置位置准备进入
-                g.targetY = 0.0f;
-                g.targetAlpha = 255.0f;
-                if (g.cfg->opacityIn.enabled) g.currentAlpha = 0.0f; else g.currentAlpha = 255.0f;
-                if (g.cfg->motionIn.enabled) g.currentY = (float)g.screenH; else g.currentY = 0.0f;
-                g.velocityY = 0.0f;
-                g.velocityAlpha = 0.0f;
-
-                g.startupState = STARTUP_PHASE_3_SHOWING;
-                g.isHidden = false;
-                g.lastActiveTime = currTime;
-                EnforceZOrder();
-            }
-        }
-        else if (g.startupState == STARTUP_PHASE_3_SHOWING) { // 2: 显示阶段
-            if (IsPhysicsIdle() || (isMoving && IsMouseOnDesktop())) {
-                g.startupState = STARTUP_NORMAL;
-                g.lastActiveTime = currTime;
-            }
-        }
-        else { // 3: 正常运行阶段
-            if (isMoving) {
-                if (IsMouseOnDesktop()) {
-                    g.lastActiveTime = currTime;
-                    g.targetY = 0.0f;
-                    g.targetAlpha = 255.0f;
-                    g.isHidden = false;
-                }
-            }
-            else {
-                if (!g.isHidden && (currTime - g.lastActiveTime > g.cfg->hideDelayMs)) {
-                    g.targetY = (float)g.screenH;
-                    g.targetAlpha = 0.0f;
-                    g.isHidden = true;
-                }
-            }
-        }
-
-        g.lastMousePos = currMouse;
+        // 由原始输入唤醒时，小于阈值的移动累积到下一次唤醒，缓慢移动也能被识别
+        if (isMoving || !g.rawInputActive) g.lastMousePos = currMouse;
 
-        // 物理更新步进
-        if (!IsPhysicsIdle()) {
-            float dt = TimerGetDelta();
-            UpdatePhysics(dt);
-            DwmFlush(); // 垂直同步等待
+        // 动画由渲染线程推进：这里只发布新的目标。动画进行中按固定间隔检查鼠标，
+        // 渲染线程进入静止时发来 WM_RENDER_IDLE，随即转入空闲等待
+        PublishAnimSnapshot();
+        if (!RenderIdle()) {
+            SetRawMouseInput(false);
+            WaitForWork(LOGIC_POLL_MS);
         }
         else {
-            if (g.currentY != g.targetY || g.currentAlpha != g.targetAlpha) UpdatePhysics(0.0f);
-            Sleep((DWORD)g.cfg->idleCheckMs);
-            TimerGetDelta(true);
+            bool wantRawInput = false;
+            DWORD wait = PlanIdleWait(currTime, isMoving, &wantRawInput);
+            SetRawMouseInput(wantRawInput);
+            WaitForWork(wait);
         }
     }
 
+    StopRenderThread();
+    CancelUpdateChecks();
+    g_Tasks.Stop();
     WTSUnRegisterSessionNotification(g.hMsgWindow);
+    SetRawMouseInput(false);
+    if (g.hWakeTimer) CloseHandle(g.hWakeTimer);
     if (hMutex) CloseHandle(hMutex);
     return 0;
 }
@@ -440,6 +1245,7 @@ int ParseVersionFromUrl(const TCHAR* url) {
 
 bool CheckSingleUrl(const TCHAR* url, HINTERNET hSession, int& outVersion, TCHAR* outFinalUrl, size_t bufferSize) {
     // 使用 Win11 默认安全配置 + 浏览器伪装
+    PerfCount(PC_HTTP_REQUEST);
     HINTERNET hUrl = InternetOpenUrl(hSession, url, NULL, 0,
         INTERNET_FLAG_RELOAD | INTERNET_FLAG_NO_CACHE_WRITE | INTERNET_FLAG_NO_COOKIES | INTERNET_FLAG_NO_UI, 0);
 
@@ -456,62 +1262,108 @@ bool CheckSingleUrl(const TCHAR* url, HINTERNET hSession, int& outVersion, TCHAR
     return false;
 }
 
-DWORD WINAPI CheckUpdateThreadProc(LPVOID lpParam) {
-    const TCHAR* checkUrl = (const TCHAR*)lpParam;
+// 一个镜像的检测结果，ver 为 0 表示失败。任意线程调用，不涉及 WinINet：
+// 第一个更高的版本胜出；都没有更高版本时，有一个成功即为最新，全部返回仍无结果则为失败
+void UpdateCheckFinished(int generation, int ver, const TCHAR* finalUrl) {
+    bool changed = false;
+    {
+        std::lock_guard<Mutex> hold(g_UpdateCtx.lock);
+        if (generation != g_UpdateCtx.generation) return; // 上一轮的迟到结果
+
+        UpdateStatus status = g_UpdateCtx.status.load(std::memory_order_relaxed);
+        if (ver > APP_VERSION_NUM) {
+            // 仅当状态未被设置为 Found 时才更新，避免重复刷新
+            if (status != US_UPDATE_FOUND) {
+                StringCchCopy(g_UpdateCtx.fastestUrl, _countof(g_UpdateCtx.fastestUrl), finalUrl);
+                g_UpdateCtx.status.store(US_UPDATE_FOUND, std::memory_order_release);
+                changed = true;
+            }
+        }
+        else if (ver > 0 && status == US_CHECKING) {
+            // 已经是最新版
+            g_UpdateCtx.status.store(US_LATEST, std::memory_order_release);
+            changed = true;
+        }
+
+        // 所有镜像都已返回且仍处于 Checking 状态，说明全部失败
+        if (--g_UpdateCtx.pending == 0 && g_UpdateCtx.status.load(std::memory_order_relaxed) == US_CHECKING) {
+            g_UpdateCtx.status.store(US_ERROR, std::memory_order_release);
+            changed = true;
+        }
+    }
+    if (changed) PostMessage(g.hMsgWindow, WM_UPDATE_UI_REFRESH, 0, 0);
+}
+
+// 后台任务：向一个镜像查询最新版本，结果交给 UpdateCheckFinished
+void CheckUpdateTask(int mirror, int generation) {
+    PerfNameThread(_T("update")); // 后台线程池中只有更新检测会计数
+    const TCHAR* checkUrl = MIRRORS[mirror];
+    int ver = 0;
+    TCHAR finalUrl[512] = { 0 };
 
     // 使用 PRECONFIG 自动适应系统代理和 TLS 设置
     HINTERNET hSession = InternetOpen(USER_AGENT, INTERNET_OPEN_TYPE_PRECONFIG, NULL, NULL, 0);
 
+    // 登记会话：退出时 CancelUpdateChecks 从其他线程关闭它，阻塞中的请求随即失败返回
+    int slot = -1;
     if (hSession) {
+        std::lock_guard<Mutex> hold(g_UpdateCtx.lock);
+        for (int i = 0; i < TASK_POOL_THREADS && !g_UpdateCtx.closing; i++) {
+            if (!g_UpdateCtx.sessions[i]) { g_UpdateCtx.sessions[i] = hSession; slot = i; break; }
+        }
+    }
+
+    if (slot >= 0) {
         // 设置超时防止卡顿
         DWORD timeout = UPDATE_TIMEOUT_MS;
         InternetSetOption(hSession, INTERNET_OPTION_CONNECT_TIMEOUT, &timeout, sizeof(timeout));
         InternetSetOption(hSession, INTERNET_OPTION_RECEIVE_TIMEOUT, &timeout, sizeof(timeout));
 
-        int ver = 0;
-        TCHAR finalUrl[512] = { 0 };
-
-        if (CheckSingleUrl(checkUrl, hSession, ver, finalUrl, sizeof(finalUrl))) {
-            // 只要有一个线程成功返回了比当前大的版本，就更新状态
-            if (ver > APP_VERSION_NUM) {
-                // 仅当状态未被设置为 Found 时才更新，避免重复刷新
-                if (g_UpdateCtx.status != US_UPDATE_FOUND) {
-                    StringCchCopy(g_UpdateCtx.fastestUrl, _countof(g_UpdateCtx.fastestUrl), finalUrl);
-                    g_UpdateCtx.status = US_UPDATE_FOUND;
-                    PostMessage(g.hMsgWindow, WM_UPDATE_UI_REFRESH, 0, 0);
-                }
-            }
-            else {
-                // 已经是最新版
-                if (g_UpdateCtx.status == US_CHECKING) {
-                    g_UpdateCtx.status = US_LATEST;
-                    PostMessage(g.hMsgWindow, WM_UPDATE_UI_REFRESH, 0, 0);
-                }
-            }
-        }
-        InternetCloseHandle(hSession);
-    }
+        if (!CheckSingleUrl(checkUrl, hSession, ver, finalUrl, sizeof(finalUrl))) ver = 0;
 
-    // 原子操作递减线程计数
-    if (InterlockedDecrement(&g_UpdateCtx.activeThreads) == 0) {
-        // 所有线程结束且仍处于 Checking 状态，说明全部失败
-        if (g_UpdateCtx.status == US_CHECKING) {
-            g_UpdateCtx.status = US_ERROR;
-            PostMessage(g.hMsgWindow, WM_UPDATE_UI_REFRESH, 0, 0);
-        }
+        // 仍在登记中说明没有被中止，由本任务关闭
+        std::lock_guard<Mutex> hold(g_UpdateCtx.lock);
+        if (g_UpdateCtx.sessions[slot] != hSession) hSession = NULL;
+        else g_UpdateCtx.sessions[slot] = NULL;
     }
+    if (hSession) InternetCloseHandle(hSession);
 
-    return 0;
+    UpdateCheckFinished(generation, ver, finalUrl);
 }
 
+// 开始新一轮检测，每个镜像一个后台任务
 void StartUpdateChecks() {
-    g_UpdateCtx.status = US_CHECKING;
-    g_UpdateCtx.fastestUrl[0] = 0;
-    g_UpdateCtx.activeThreads = _countof(MIRRORS);
-    g_UpdateCtx.hasCheckStarted = true;
+    int generation;
+    {
+        std::lock_guard<Mutex> hold(g_UpdateCtx.lock);
+        generation = ++g_UpdateCtx.generation;
+        g_UpdateCtx.fastestUrl[0] = 0;
+        g_UpdateCtx.pending = _countof(MIRRORS);
+        g_UpdateCtx.status.store(US_CHECKING, std::memory_order_relaxed);
+        g_UpdateCtx.hasCheckStarted = true;
+    }
+
+    g_Tasks.Cancel(CheckUpdateTask); // 上一轮还在排队的检测不必再做
+    for (int i = 0; i < (int)_countof(MIRRORS); i++) {
+        if (!g_Tasks.Submit(CheckUpdateTask, i, generation, TASK_PRIORITY_LOW, 0)) {
+            UpdateCheckFinished(generation, 0, NULL); // 无法提交，按该镜像失败计
+        }
+    }
+}
 
-    for (int i = 0; i < _countof(MIRRORS); i++) {
-        CloseHandle(CreateThread(NULL, 0, CheckUpdateThreadProc, (LPVOID)MIRRORS[i], 0, NULL));
+// 退出时调用：不再开始新的检测，关闭进行中的会话。之后 g_Tasks.Stop 只需等待各任务收尾
+void CancelUpdateChecks() {
+    HINTERNET sessions[TASK_POOL_THREADS];
+    {
+        std::lock_guard<Mutex> hold(g_UpdateCtx.lock);
+        g_UpdateCtx.closing = true;
+        for (int i = 0; i < TASK_POOL_THREADS; i++) {
+            sessions[i] = g_UpdateCtx.sessions[i];
+            g_UpdateCtx.sessions[i] = NULL;
+        }
+    }
+    for (int i = 0; i < TASK_POOL_THREADS; i++) {
+        if (sessions[i]) InternetCloseHandle(sessions[i]);
     }
 }
 
@@ -543,6 +1395,7 @@ void RefreshMenuText() {
     ModifyMenu(g_UpdateCtx.hActiveMenu, ID_TRAY_UPDATE, uFlags, ID_TRAY_UPDATE, szText);
 
     // 强制刷新系统菜单窗口 (#32768)
+    PerfCount(PC_FINDWINDOW);
     HWND hMenuWnd = FindWindow(_T("#32768"), NULL);
     if (hMenuWnd && IsWindowVisible(hMenuWnd)) {
         InvalidateRect(hMenuWnd, NULL, TRUE);
@@ -560,271 +1413,1742 @@ void ShowTrayMenu(HWND hwnd) {
         StartUpdateChecks();
     }
 
-    HMENU hMenu = CreatePopupMenu();
-    g_UpdateCtx.hActiveMenu = hMenu;
+    HMENU hMenu = CreatePopupMenu();
+    g_UpdateCtx.hActiveMenu = hMenu;
+
+    // 构建动态更新菜单项
+    TCHAR szUpdateText[128];
+    UINT uUpdateFlags = MF_STRING;
+
+    if (g_UpdateCtx.status == US_UPDATE_FOUND) {
+        _tcscpy_s(szUpdateText, _countof(szUpdateText), _T("已检测到更新版本，点击跳转至下载页面"));
+    }
+    else {
+        _tcscpy_s(szUpdateText, _countof(szUpdateText), _T("正在检查新版本..."));
+        uUpdateFlags |= MF_GRAYED;
+    }
+    AppendMenu(hMenu, uUpdateFlags, ID_TRAY_UPDATE, szUpdateText);
+    AppendMenu(hMenu, MF_SEPARATOR, 0, NULL);
+
+    // 动画模式子菜单
+    HMENU hSubProfile = CreatePopupMenu();
+    for (int i = 0; i < PRESET_COUNT; i++) {
+        UINT flags = MF_STRING;
+        if (i == g.cfgIndex) flags |= MF_CHECKED;
+        AppendMenu(hSubProfile, flags, ID_PROFILE_START + i, PRESETS[i].name);
+    }
+    AppendMenu(hMenu, MF_POPUP, (UINT_PTR)hSubProfile, _T("动画模式 (Animation Mode)"));
+
+    // 蒙版子菜单
+    HMENU hSubMask = CreatePopupMenu();
+    for (int i = 0; i < MASK_OPT_COUNT; i++) {
+        UINT flags = MF_STRING;
+        if (i == g.maskOptIndex) flags |= MF_CHECKED;
+
+        TCHAR buf[64] = { 0 };
+        if (MASK_OPTIONS[i].percent == 0) _tcscpy_s(buf, _countof(buf), _T("关闭 (Off)"));
+        else _stprintf_s(buf, _countof(buf), _T("%d%% 浓度 (Opacity)"), MASK_OPTIONS[i].percent);
+
+        AppendMenu(hSubMask, flags, ID_MASK_START + i, buf);
+    }
+    AppendMenu(hMenu, MF_POPUP, (UINT_PTR)hSubMask, _T("背景蒙版 (Background Mask)"));
+
+    // 帧率上限子菜单
+    HMENU hSubFrameCap = CreatePopupMenu();
+    for (int i = 0; i < FRAME_CAP_COUNT; i++) {
+        UINT flags = MF_STRING;
+        if (i == g.frameCapIndex) flags |= MF_CHECKED;
+
+        TCHAR buf[64] = { 0 };
+        if (FRAME_CAP_OPTIONS[i] == 0) _tcscpy_s(buf, _countof(buf), _T("跟随刷新率 (Refresh Rate)"));
+        else _stprintf_s(buf, _countof(buf), _T("%d FPS"), FRAME_CAP_OPTIONS[i]);
+
+        AppendMenu(hSubFrameCap, flags, ID_FRAMECAP_START + i, buf);
+    }
+    AppendMenu(hMenu, MF_POPUP, (UINT_PTR)hSubFrameCap, _T("帧率上限 (Frame Rate Cap)"));
+
+    AppendMenu(hMenu, MF_SEPARATOR, 0, NULL);
+
+    // 开机自启
+    UINT autoStartFlags = MF_STRING;
+    if (IsAutoStartEnabled()) autoStartFlags |= MF_CHECKED;
+    AppendMenu(hMenu, autoStartFlags, ID_TRAY_AUTOSTART, _T("开机自启 (Auto Start)"));
+    AppendMenu(hMenu, MF_STRING, ID_TRAY_COUNTERS, _T("导出性能计数 (Export Counters)"));
+    AppendMenu(hMenu, MF_STRING, ID_TRAY_FLIGHT, _T("导出帧记录 (Export Frame Log)"));
+
+    AppendMenu(hMenu, MF_SEPARATOR, 0, NULL);
+    AppendMenu(hMenu, MF_STRING, ID_TRAY_EXIT, _T("退出程序 (Exit)"));
+
+    TrackPopupMenu(hMenu, TPM_BOTTOMALIGN | TPM_LEFTALIGN, p.x, p.y, 0, hwnd, NULL);
+
+    g_UpdateCtx.hActiveMenu = NULL;
+    DestroyMenu(hMenu);
+}
+
+// --- 消息处理 ---
+
+// 提交一条命令给逻辑线程，任意线程可调用，不会丢弃。队列满时写入该命令的合并格；
+// 合并格中已有待执行的同类命令时也写入合并格，保证同类命令不会越过它先执行
+void PostLogicCommand(int type, int arg) {
+    LogicCommand c = { type, arg };
+    CommandOverflow& o = g_CommandOverflow[type];
+    if (o.set.load(std::memory_order_acquire) || !g_Commands.Push(c)) {
+        o.arg.store(arg, std::memory_order_relaxed);
+        o.set.store(true, std::memory_order_release);
+    }
+    if (g.hMsgWindow) PostMessage(g.hMsgWindow, WM_LOGIC_COMMAND, 0, 0); // 主循环可能正在无限等待
+}
+
+// 后台任务：显示设置变化后延迟执行，让逻辑线程重新定位桌面
+void DisplayResetTask(int arg0, int arg1) {
+    PostLogicCommand(CMD_DISPLAY_RESET);
+}
+
+// 逻辑线程：按提交顺序执行队列中的全部命令，再执行合并格中的命令
+void RunLogicCommands() {
+    LogicCommand c;
+    bool any = false;
+    while (g_Commands.Pop(c)) {
+        any = true;
+        ExecuteLogicCommand(c);
+    }
+    for (int type = 0; type < CMD_COUNT; type++) {
+        CommandOverflow& o = g_CommandOverflow[type];
+        if (!o.set.exchange(false, std::memory_order_acq_rel)) continue;
+        // 清除标志之后才读参数：与之交错的提交会重新置位，最坏情况下同一参数多执行一次
+        c.type = type;
+        c.arg = o.arg.load(std::memory_order_relaxed);
+        any = true;
+        ExecuteLogicCommand(c);
+    }
+    if (any) PublishAnimSnapshot();
+}
+
+// 逻辑线程：执行一条命令。只修改 g 中的状态与请求序号，由调用方随后发布快照
+void ExecuteLogicCommand(const LogicCommand& c) {
+    switch (c.type) {
+    case CMD_SET_PROFILE:
+        g.cfgIndex = c.arg;
+        HotSwapSettings();
+        break;
+    case CMD_SET_MASK:
+        g.maskOptIndex = c.arg;
+        HotSwapSettings();
+        break;
+    case CMD_SET_FRAME_CAP: // 帧率上限不影响曲线，下一帧即生效
+        g.frameCapIndex = c.arg;
+        SaveSettings();
+        break;
+    case CMD_SHOW: // 从当前位置与速度继续，不跳变；启动流程进行中时由它自行转入显示
+        if (g.startupState == STARTUP_NORMAL) {
+            g.isHidden = false;
+            g.targetY = 0.0f;
+            g.targetAlpha = 255.0f;
+        }
+        g.lastActiveTime = g_Clock->tickMs();
+        break;
+    case CMD_SET_PAUSED:
+        g_Flags.isPaused = (c.arg != 0);
+        if (!c.arg) g.lastActiveTime = g_Clock->tickMs();
+        break;
+    case CMD_DISPLAY_RESET:
+        g.hContainer = NULL;
+        g.displaySeq++; // 刷新率可能已改变
+        break;
+    case CMD_SAVE_FRAME_LOG: // 缓冲归渲染线程所有，由它写出后发回 WM_FLIGHT_SAVED
+        g.flightSaveSeq++;
+        break;
+    }
+}
+
+LRESULT CALLBACK MsgWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
+    if (msg == g_uMsgTaskbarCreated && g_uMsgTaskbarCreated != 0) {
+        PostLogicCommand(CMD_DISPLAY_RESET); // 任务栏重启需重新定位桌面
+        return 0;
+    }
+    switch (msg) {
+    case WM_TRAYICON:
+        if (lParam == WM_RBUTTONUP) {
+            // 菜单是模态的，主循环要等菜单关闭才会继续：本线程即逻辑线程，弹出前先执行。
+            // 菜单打开期间渲染线程照常推进显示动画，此时切换配置由 HotSwapSettings 接续进行中的动画
+            PostLogicCommand(CMD_SHOW);
+            RunLogicCommands();
+            ShowTrayMenu(hwnd);
+        }
+        else if (lParam == WM_MOUSEMOVE) {
+            UpdateTrayTooltip();
+        }
+        break;
+
+    case WM_RENDER_IDLE: // 只用于唤醒主循环
+    case WM_LOGIC_COMMAND:
+        return 0;
+
+    case WM_FLIGHT_SAVED:
+        if (wParam == FLIGHT_REASON_MANUAL) { // 卡顿时的自动保存不打扰用户
+            TCHAR szPath[MAX_PATH];
+            FlightRecordPath(szPath, _countof(szPath));
+            TCHAR msg[MAX_PATH + 64];
+            if (lParam) _stprintf_s(msg, _countof(msg), _T("帧记录已保存至：\n%s"), szPath);
+            else _stprintf_s(msg, _countof(msg), _T("无法写入帧记录：\n%s"), szPath);
+            MessageBox(NULL, msg, APP_NAME, MB_OK | (lParam ? MB_ICONINFORMATION : MB_ICONWARNING));
+        }
+        return 0;
+
+        // 响应后台线程的刷新请求
+    case WM_UPDATE_UI_REFRESH:
+        RefreshMenuText();
+        break;
+
+    case WM_WTSSESSION_CHANGE:
+        if (wParam == WTS_SESSION_LOCK) PostLogicCommand(CMD_SET_PAUSED, 1);
+        else if (wParam == WTS_SESSION_UNLOCK) PostLogicCommand(CMD_SET_PAUSED, 0);
+        break;
+
+    case WM_COMMAND: {
+        int cmdId = LOWORD(wParam);
+        if (cmdId == ID_TRAY_EXIT) {
+            g_Flags.appRunning = false;
+            PerformExitSequence();
+        }
+        else if (cmdId == ID_TRAY_AUTOSTART) {
+            SetAutoStart(!IsAutoStartEnabled());
+        }
+        else if (cmdId == ID_TRAY_COUNTERS) {
+            ExportPerfCounters();
+        }
+        else if (cmdId == ID_TRAY_FLIGHT) {
+            PostLogicCommand(CMD_SAVE_FRAME_LOG);
+        }
+        else if (cmdId == ID_TRAY_UPDATE) {
+            // 点击更新跳转
+            if (g_UpdateCtx.status == US_UPDATE_FOUND && g_UpdateCtx.fastestUrl[0] != 0) {
+                ShellExecute(NULL, _T("open"), g_UpdateCtx.fastestUrl, NULL, NULL, SW_SHOW);
+            }
+        }
+        else if (cmdId >= ID_PROFILE_START && cmdId < ID_PROFILE_START + PRESET_COUNT) {
+            PostLogicCommand(CMD_SET_PROFILE, cmdId - ID_PROFILE_START);
+        }
+        else if (cmdId >= ID_MASK_START && cmdId < ID_MASK_START + MASK_OPT_COUNT) {
+            PostLogicCommand(CMD_SET_MASK, cmdId - ID_MASK_START);
+        }
+        else if (cmdId >= ID_FRAMECAP_START && cmdId < ID_FRAMECAP_START + FRAME_CAP_COUNT) {
+            PostLogicCommand(CMD_SET_FRAME_CAP, cmdId - ID_FRAMECAP_START);
+        }
+        break;
+    }
+    case WM_DISPLAYCHANGE:
+        // 切换分辨率时可能连续收到多条：只保留最后一次，等显示稳定后再重新定位桌面
+        g_Tasks.Cancel(DisplayResetTask);
+        if (!g_Tasks.Submit(DisplayResetTask, 0, 0, TASK_PRIORITY_HIGH, DISPLAY_RESET_DELAY_MS)) {
+            PostLogicCommand(CMD_DISPLAY_RESET);
+        }
+        break;
+    case WM_DESTROY:
+        g_Flags.appRunning = false;
+        return 0;
+    }
+    return DefWindowProc(hwnd, msg, wParam, lParam);
+}
+
+// --- 基础工具实现 ---
+
+ULONGLONG RealTickMs() {
+    return GetTickCount64();
+}
+
+LONGLONG RealCounter() {
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    return now.QuadPart;
+}
+
+LONGLONG RealFrequency() {
+    LARGE_INTEGER freq;
+    QueryPerformanceFrequency(&freq);
+    return freq.QuadPart;
+}
+
+// 等待消息或截止时刻到达。截止时刻由可等待定时器给出，INFINITE 时只等待消息
+void RealWait(DWORD ms) {
+    if (ms == 0) return;
+    PerfCount(PC_WAKEUP);
+    if (!g.hWakeTimer) {
+        MsgWaitForMultipleObjectsEx(0, NULL, ms, QS_ALLINPUT, MWMO_INPUTAVAILABLE);
+        return;
+    }
+    if (ms == INFINITE) {
+        CancelWaitableTimer(g.hWakeTimer);
+    }
+    else {
+        LARGE_INTEGER due;
+        due.QuadPart = -(LONGLONG)ms * 10000; // 相对时间，单位 100ns
+        SetWaitableTimer(g.hWakeTimer, &due, 0, NULL, NULL, FALSE);
+    }
+    MsgWaitForMultipleObjectsEx(1, &g.hWakeTimer, INFINITE, QS_ALLINPUT, MWMO_INPUTAVAILABLE);
+}
+
+// 帧率上限下跳过刷新周期：相对时间设置高精度定时器，只等待定时器 (渲染线程没有消息需要处理)
+void RealWaitUntil(LONGLONG counter) {
+    LONGLONG remain = counter - RealCounter();
+    if (remain <= 0 || !g_Render.hFrameTimer) return;
+    PerfCount(PC_WAKEUP);
+    LARGE_INTEGER due;
+    due.QuadPart = -remain * 10000000 / RealFrequency(); // 相对时间，单位 100ns
+    if (due.QuadPart == 0) return;
+    SetWaitableTimer(g_Render.hFrameTimer, &due, 0, NULL, NULL, FALSE);
+    WaitForSingleObject(g_Render.hFrameTimer, INFINITE);
+}
+
+void RealVSync() {
+    PerfCount(PC_DWMFLUSH);
+    DwmFlush();
+}
+
+bool RealVBlankTiming(LONGLONG* vblank, LONGLONG* period) {
+    DWM_TIMING_INFO info = { 0 };
+    info.cbSize = sizeof(info);
+    if (FAILED(DwmGetCompositionTimingInfo(NULL, &info)) || info.qpcRefreshPeriod == 0) return false;
+    *vblank = (LONGLONG)info.qpcVBlank;
+    *period = (LONGLONG)info.qpcRefreshPeriod;
+    return true;
+}
+
+// 虚拟时钟以微秒计，等待立即返回并推进时间
+ULONGLONG VirtualTickMs() {
+    return (ULONGLONG)(g_VirtualClock.nowUs / 1000);
+}
+
+LONGLONG VirtualCounter() {
+    return g_VirtualClock.nowUs;
+}
+
+LONGLONG VirtualFrequency() {
+    return 1000000;
+}
+
+void VirtualWait(DWORD ms) {
+    g_VirtualClock.wakeups++;
+    if (ms != INFINITE) g_VirtualClock.nowUs += (LONGLONG)ms * 1000;
+}
+
+void VirtualWaitUntil(LONGLONG counter) {
+    if (counter <= g_VirtualClock.nowUs) return;
+    g_VirtualClock.wakeups++;
+    g_VirtualClock.nowUs = counter;
+}
+
+void VirtualVSync() {
+    g_VirtualClock.vsyncs++;
+    g_VirtualClock.nowUs = (g_VirtualClock.nowUs / g_VirtualClock.vblankUs + 1) * g_VirtualClock.vblankUs;
+}
+
+bool VirtualVBlankTiming(LONGLONG* vblank, LONGLONG* period) {
+    *period = g_VirtualClock.vblankUs;
+    *vblank = g_VirtualClock.nowUs / g_VirtualClock.vblankUs * g_VirtualClock.vblankUs;
+    return true;
+}
+
+const Clock REAL_CLOCK = { RealTickMs, RealCounter, RealFrequency, RealWait, RealWaitUntil, RealVSync, RealVBlankTiming };
+const Clock VIRTUAL_CLOCK = { VirtualTickMs, VirtualCounter, VirtualFrequency, VirtualWait, VirtualWaitUntil, VirtualVSync, VirtualVBlankTiming };
+
+// 切换时钟后从零开始计时，统计清零
+void UseVirtualClock(bool enable) {
+    g_Clock = enable ? &VIRTUAL_CLOCK : &REAL_CLOCK;
+    g_VirtualClock.nowUs = 0;
+    g_VirtualClock.vblankUs = VIRTUAL_VBLANK_US;
+    g_VirtualClock.wakeups = 0;
+    g_VirtualClock.vsyncs = 0;
+    g_Render.pacer.timingValid = false;
+    g_Render.pacer.nextDue = 0;
+    g_Render.pacer.synced = 0;
+    TimerInit();
+}
+
+// 为当前线程分配计数块，首次计数时调用
+PerfCounterBlock* PerfAttachThread() {
+    LONG index = g_PerfBlockCount.fetch_add(1);
+    if (index >= PERF_MAX_THREADS) index = PERF_MAX_THREADS - 1;
+    t_PerfBlock = &g_PerfBlocks[index];
+    return t_PerfBlock;
+}
+
+void PerfCount(int id) {
+    PerfCounterBlock* b = t_PerfBlock ? t_PerfBlock : PerfAttachThread();
+    if (b == &g_PerfBlocks[PERF_MAX_THREADS - 1]) b->counts[id].fetch_add(1, std::memory_order_relaxed);
+    else b->counts[id].store(b->counts[id].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed); // 只有本线程写入，不需要原子自增
+}
+
+// 为本线程的计数块命名，导出时按线程分列。线程启动时调用，同时尽早占下独占的计数块
+void PerfNameThread(const TCHAR* name) {
+    PerfCounterBlock* b = t_PerfBlock ? t_PerfBlock : PerfAttachThread();
+    b->thread.store(name, std::memory_order_relaxed);
+}
+
+// 汇总所有线程的计数。读取不加锁，结果可能比正在进行的自增略旧
+void PerfCollect(LONGLONG* totals) {
+    for (int id = 0; id < PC_COUNT; id++) totals[id] = 0;
+    LONG blocks = g_PerfBlockCount.load();
+    if (blocks > PERF_MAX_THREADS) blocks = PERF_MAX_THREADS;
+    for (int i = 0; i < blocks; i++) {
+        for (int id = 0; id < PC_COUNT; id++) totals[id] += g_PerfBlocks[i].counts[id].load(std::memory_order_relaxed);
+    }
+}
+
+void TimerInit() {
+    g_Render.qpcFreq.QuadPart = g_Clock->frequency();
+    g_Render.qpcLastTime.QuadPart = g_Clock->counter();
+}
+
+float TimerGetDelta(bool resetOnly) {
+    LARGE_INTEGER now;
+    now.QuadPart = g_Clock->counter();
+    if (resetOnly) {
+        g_Render.qpcLastTime = now;
+        return 0.0f;
+    }
+    // 防止除以0（虽然在Win32下几乎不可能发生）
+    if (g_Render.qpcFreq.QuadPart == 0) return 0.016f;
+
+    float dt = (float)((double)(now.QuadPart - g_Render.qpcLastTime.QuadPart) / (double)g_Render.qpcFreq.QuadPart);
+    g_Render.qpcLastTime = now;
+
+    // 帧时间钳制，防止Debug断点后一次推进过多物理步
+    if (dt > MAX_FRAME_DELTA) dt = MAX_FRAME_DELTA;
+    if (dt < 0.0001f) dt = 0.0001f;
+    return dt;
+}
+
+// 把计时基准推进到指定时刻 (可以在未来)，返回推进的时长。钳制规则与 TimerGetDelta 相同
+float TimerAdvanceTo(LONGLONG targetQpc) {
+    if (g_Render.qpcFreq.QuadPart == 0) return 0.016f;
+    float dt = (float)((double)(targetQpc - g_Render.qpcLastTime.QuadPart) / (double)g_Render.qpcFreq.QuadPart);
+    if (targetQpc > g_Render.qpcLastTime.QuadPart) g_Render.qpcLastTime.QuadPart = targetQpc;
+    if (dt > MAX_FRAME_DELTA) dt = MAX_FRAME_DELTA;
+    if (dt < 0.0001f) dt = 0.0001f;
+    return dt;
+}
+
+// 注册/注销后台原始鼠标输入，消息窗口借此在鼠标移动时被唤醒
+void SetRawMouseInput(bool enable) {
+    if (g.rawInputActive == enable || !g.hMsgWindow) return;
+    RAWINPUTDEVICE rid = { 0x01, 0x02, enable ? (DWORD)RIDEV_INPUTSINK : (DWORD)RIDEV_REMOVE, enable ? g.hMsgWindow : NULL };
+    if (RegisterRawInputDevices(&rid, 1, sizeof(rid))) g.rawInputActive = enable;
+}
+
+// 空闲时在下一次必须检查状态之前可以等待的毫秒数，INFINITE 表示只等待消息。
+// 只读取全局状态，不调用系统接口
+DWORD PlanIdleWait(ULONGLONG now, bool wasMoving, bool* wantRawInput) {
+    *wantRawInput = false;
+    if (g.startupState != STARTUP_NORMAL) return (DWORD)g.cfg->idleCheckMs; // 启动/切换流程很短，仍按原间隔轮询
+    if (!g.isHidden) {
+        if (g.cfg->hideDelayMs == 0xFFFFFFFF) return INFINITE; // 常显
+        // 显示中只需在隐藏截止时刻醒来，届时再检查期间是否有过桌面上的鼠标移动
+        ULONGLONG deadline = g.lastActiveTime + g.cfg->hideDelayMs + 1;
+        return (deadline > now) ? (DWORD)(deadline - now) : 0;
+    }
+    // 已隐藏：由原始鼠标输入唤醒。刚因移动醒来但鼠标不在桌面上时按原间隔轮询，
+    // 避免用户在其他窗口中操作时每次移动都唤醒；鼠标静止后恢复无限等待
+    if (wasMoving) return (DWORD)g.cfg->idleCheckMs;
+    // 原始输入限流：距上一次由它唤醒不足 idleCheckMs 时先注销，到时再检查。
+    // 缓慢移动时每条 WM_INPUT 都会唤醒主循环，限流后每个间隔最多醒来两次
+    if (g.rawInputWakeTime && now - g.rawInputWakeTime < g.cfg->idleCheckMs) {
+        return (DWORD)(g.rawInputWakeTime + g.cfg->idleCheckMs - now);
+    }
+    *wantRawInput = true;
+    return INFINITE;
+}
+
+void WaitForWork(DWORD ms) {
+    g_Clock->wait(ms);
+}
+
+// 严格晚于 now 的第一个垂直同步时刻；周期无效时返回 now
+LONGLONG PredictNextVBlank(LONGLONG now, LONGLONG lastVBlank, LONGLONG period) {
+    if (period <= 0) return now;
+    if (lastVBlank > now) return lastVBlank;
+    return lastVBlank + ((now - lastVBlank) / period + 1) * period;
+}
+
+// 查询并缓存刷新周期与一次垂直同步的时刻，之后的垂直同步由周期推算
+void RefreshDisplayTiming() {
+    LONGLONG vblank, period;
+    if (g_Clock->vblankTiming(&vblank, &period)) {
+        g_Render.pacer.vblank = vblank;
+        g_Render.pacer.period = period;
+    }
+    else {
+        g_Render.pacer.period = 0;
+    }
+    g_Render.pacer.timingValid = true;
+}
+
+// 帧率上限对应的帧间隔 (计数)，未设上限时为 0
+LONGLONG FrameCapInterval() {
+    const AnimSnapshot& v = g_Render.view;
+    int fps = FRAME_CAP_OPTIONS[v.frameCapIndex];
+    return fps > 0 ? g_Clock->frequency() / fps : 0;
+}
+
+// 动画尾段降频：沿曲线前瞻，只要再推迟一个刷新周期后各通道的量化值相对上一帧仍最多变化 1
+// (一个像素或一级透明度)，就把提交推迟到那一次垂直同步。快速运动时每个周期都超过 1，保持满帧率；
+// 尾段每帧的可见变化与满帧率时相同，只是省去了输出不变或只差一级的帧
+LONGLONG StretchFrameTarget(LONGLONG target) {
+    const AnimSnapshot& v = g_Render.view;
+    FramePacer& fp = g_Render.pacer;
+    if (PhysicsTimeToSettle() <= 0.0f) return target; // 目标刚变化尚未起段，没有可前瞻的曲线
+    const SpringBank& b = g_Render.bank;
+    const int lanes[3] = { LANE_Y, LANE_ALPHA, LANE_MASK };
+
+    // 上一帧的渲染时刻位于最近两步之间，由累加器余量给出
+    float last[3];
+    float from[3];
+    float behind = (float)(ActivePhysicsStepUs() - g_Render.physicsAccumulatorUs) * 1e-6f;
+    for (int i = 0; i < 3; i++) {
+        last[i] = b.elapsed[lanes[i]] - behind;
+        from[i] = BankValueAt(b, lanes[i], last[i]);
+    }
+
+    double scale = 1.0 / (double)g_Clock->frequency();
+    if (v.accelerated) scale *= STARTUP_SPEED_FACTOR;
+    LONGLONG maxSpan = g_Clock->frequency() * FRAME_STRETCH_MAX_MS / 1000;
+    for (LONGLONG later = target + fp.period; later + fp.period - g_Render.qpcLastTime.QuadPart <= maxSpan; later += fp.period) {
+        // 推迟后的呈现时刻距上一帧的时间；未量化的变化小于 1 时量化值最多变化 1
+        float ahead = (float)((later + fp.period - g_Render.qpcLastTime.QuadPart) * scale);
+        for (int i = 0; i < 3; i++) {
+            if (fabsf(BankValueAt(b, lanes[i], last[i] + ahead) - from[i]) >= FRAME_STRETCH_DELTA) return target;
+        }
+        target = later;
+    }
+    return target;
+}
+
+// 选出本帧提交所在的垂直同步，返回该帧的预计呈现时刻：帧在该次垂直同步后提交，再下一次垂直同步时才会呈现。
+// 取不到合成计时信息时退回当前时刻，行为与逐帧计时一致
+LONGLONG PlanFrame() {
+    FramePacer& fp = g_Render.pacer;
+    if (!fp.timingValid) RefreshDisplayTiming();
+    LONGLONG now = g_Clock->counter();
+    fp.target = 0;
+    if (fp.period <= 0) return now;
+
+    LONGLONG next = PredictNextVBlank(now, fp.vblank, fp.period);
+    // 实际垂直同步相对外推时刻有抖动：上一帧可能在外推时刻之前一点就已返回，
+    // 距它不足半个周期的外推时刻就是刚等到的那一次，不再重复作为目标
+    if (fp.synced != 0 && next - fp.synced < fp.period / 2) next += fp.period;
+    fp.target = next;
+    LONGLONG interval = FrameCapInterval();
+    bool capped = (interval > fp.period);
+    // 取最接近理想时刻的垂直同步，非整数倍的上限 (如 144 Hz 下 60 FPS) 也能均匀分布
+    if (capped && fp.nextDue > next) {
+        LONGLONG nearest = fp.vblank + (fp.nextDue - fp.vblank + fp.period / 2) / fp.period * fp.period;
+        if (nearest > next) fp.target = nearest;
+    }
+    if (!fp.fixedRate) fp.target = StretchFrameTarget(fp.target);
+    if (capped) {
+        // 理想时刻累加以保持平均帧率；落后超过一帧时从本帧重新计时，不补帧
+        if (fp.nextDue != 0 && fp.target - fp.nextDue < interval) fp.nextDue += interval;
+        else fp.nextDue = fp.target + interval;
+    }
+    return fp.target + fp.period;
+}
+
+// 等待到本帧的垂直同步：目标在一个周期之后时先睡到目标前半个周期，再由垂直同步对齐
+void WaitForFrame() {
+    FramePacer& fp = g_Render.pacer;
+    if (fp.target != 0 && fp.target - g_Clock->counter() > fp.period) g_Clock->waitUntil(fp.target - fp.period / 2);
+    g_Clock->vsync();
+    fp.synced = g_Clock->counter();
+}
+
+// 动画结束：空闲期间相位会漂移，下次动画开始时重新查询
+void EndFramePacing() {
+    g_Render.pacer.nextDue = 0;
+    g_Render.pacer.synced = 0;
+    g_Render.pacer.timingValid = false;
+}
+
+void InitGlobalPaths() {
+    TCHAR szProgramFiles[MAX_PATH];
+    if (SUCCEEDED(SHGetFolderPath(NULL, CSIDL_PROGRAM_FILES, NULL, 0, szProgramFiles))) {
+        PathCombine(g_Paths.szInstallDir, szProgramFiles, _T("AutoICON"));
+    }
+    else {
+        _tcscpy_s(g_Paths.szInstallDir, _countof(g_Paths.szInstallDir), _T("C:\\Program Files\\AutoICON"));
+    }
+    PathCombine(g_Paths.szInstallExePath, g_Paths.szInstallDir, EXE_NAME);
+}
+
+// --- 物理引擎实现 ---
+
+// 阻尼振子 x'' = -k·x - c·v 的解析解，任意 dt 均为常数时间求值，无需子步进
+void SolveSpring(float& current, float& velocity, float target, const SpringParams& p, float dt) {
+    if (p.tension <= 0.0f) return;
+
+    double x0 = current - target;
+    double v0 = velocity;
+    double omega = sqrt((double)p.tension);
+    double zeta = p.friction / (2.0 * omega);
+    double t = dt;
+    double x, v;
+
+    if (zeta < 1.0 - 1e-4) { // 欠阻尼
+        double sigma = zeta * omega;
+        double wd = omega * sqrt(1.0 - zeta * zeta);
+        double decay = exp(-sigma * t);
+        double cs = cos(wd * t), sn = sin(wd * t);
+        x = decay * (x0 * cs + (v0 + sigma * x0) / wd * sn);
+        v = decay * (v0 * cs - (sigma * v0 + omega * omega * x0) / wd * sn);
+    }
+    else if (zeta <= 1.0 + 1e-4) { // 临界阻尼
+        double decay = exp(-omega * t);
+        double b = v0 + omega * x0;
+        x = (x0 + b * t) * decay;
+        v = (v0 - omega * t * b) * decay;
+    }
+    else { // 过阻尼
+        double s = omega * sqrt(zeta * zeta - 1.0);
+        double r1 = -zeta * omega + s;
+        double r2 = -zeta * omega - s;
+        double c1 = (v0 - r2 * x0) / (r1 - r2);
+        double c2 = x0 - c1;
+        double e1 = exp(r1 * t), e2 = exp(r2 * t);
+        x = c1 * e1 + c2 * e2;
+        v = c1 * r1 * e1 + c2 * r2 * e2;
+    }
+
+    current = (float)(target + x);
+    velocity = (float)v;
+
+    // 浮点数安全检查
+    if (_isnan(current) || !_finite(current)) current = target;
+    if (_isnan(velocity) || !_finite(velocity)) velocity = 0.0f;
+}
+
+// 衰减最慢的模态的衰减率，用于确定曲线时长
+double SpringDecayRate(const SpringParams& p) {
+    double omega = sqrt((double)p.tension);
+    double zeta = p.friction / (2.0 * omega);
+    if (zeta <= 1.0) return zeta * omega;
+    return omega * (zeta - sqrt(zeta * zeta - 1.0));
+}
+
+void BakeSpringCurve(SpringCurve& c, const SpringParams& p) {
+    c.params = p;
+
+    // 缓动曲线取其给定时长；弹簧留出 1 个 e 折叠的余量，覆盖振幅系数与临界阻尼的多项式项
+    double duration = (p.duration > 0.0f) ? p.duration : (log(1.0 / CURVE_SETTLE_RATIO) + 1.0) / SpringDecayRate(p);
+    c.stepUs = (int)ceil(duration * 1e6 / (CURVE_SAMPLES - 1));
+    double step = c.stepUs * 1e-6;
+    c.invStep = (float)(1.0 / step);
+#ifdef SPRING_FIXED_POINT
+    c.invStepQ = ((1LL << 32) + c.stepUs / 2) / c.stepUs;
+#endif
+
+    for (int k = 0; k < CURVE_SAMPLES; k++) {
+        float t = (float)(k * step);
+        float x = 1.0f, v = 0.0f;
+        float xv = 0.0f, vv = 1.0f;
+        if (p.duration > 0.0f) {
+            // 缓动曲线不继承初速度，中途改变目标时从当前位置重新开始整条曲线
+            double ease = 1.0, slope = 0.0;
+            if (t < p.duration) CubicBezierEase(p.bezier, t / p.duration, ease, slope);
+            x = (float)(1.0 - ease);
+            v = (float)(-slope / p.duration);
+            xv = vv = 0.0f;
+        }
+        else {
+            SolveSpring(x, v, 0.0f, p, t);
+            SolveSpring(xv, vv, 0.0f, p, t);
+        }
+        c.s[k].pos = x; c.s[k].vel = v;
+        c.s[k].posV = xv; c.s[k].velV = vv;
+#ifdef SPRING_FIXED_POINT
+        c.q[k].pos = FixedFromFloat(x, FIXED_CURVE_SHIFT);
+        c.q[k].vel = FixedFromFloat(v, FIXED_CURVE_SHIFT);
+        c.q[k].posV = FixedFromFloat(xv, FIXED_CURVE_SHIFT);
+        c.q[k].velV = FixedFromFloat(vv, FIXED_CURVE_SHIFT);
+#endif
+    }
+}
+
+// 为所有预设中出现的弹簧与缓动参数烘焙曲线，相同参数只烘焙一次
+void BakeSpringCurves() {
+    g_CurveCount = 0;
+    for (int i = 0; i < PRESET_COUNT; i++) {
+        const SpringParams* springs[4] = { &PRESETS[i].motionIn, &PRESETS[i].motionOut, &PRESETS[i].opacityIn, &PRESETS[i].opacityOut };
+        for (int j = 0; j < 4; j++) {
+            if (!springs[j]->enabled || FindSpringCurve(*springs[j])) continue;
+            BakeSpringCurve(g_Curves[g_CurveCount++], *springs[j]);
+        }
+    }
+}
+
+const SpringCurve* FindSpringCurve(const SpringParams& p) {
+    for (int i = 0; i < g_CurveCount; i++) {
+        const SpringParams& q = g_Curves[i].params;
+        if (q.tension == p.tension && q.friction == p.friction && q.duration == p.duration &&
+            memcmp(q.bezier, p.bezier, sizeof(q.bezier)) == 0) return &g_Curves[i];
+    }
+    return NULL;
+}
+
+// 通道值到窗口参数的量化方式。四舍五入使目标两侧对称，
+// 从下方逼近 255 的透明度不会长时间停在 254
+int RenderQuantize(float v) {
+    return (int)floorf(v + 0.5f);
+}
+
+// 浮点到定点的饱和换算，只在烘焙与起段时调用
+int FixedFromFloat(double v, int shift) {
+    double q = floor(v * (double)(1 << shift) + 0.5);
+    if (q > FIXED_LIMIT) return FIXED_LIMIT;
+    if (q < -FIXED_LIMIT) return -FIXED_LIMIT;
+    return (int)q;
+}
+
+// 从曲线末端向前扫描，找到钳制并量化后的渲染值最后一次不同于目标的采样点。
+// 线性插值、钳制与量化都是单调的，相邻两个采样点量化结果相同则其间任意时刻也相同，
+// 因此该时刻之后任何一帧都不会再改变输出
+float BankSettleTime(const SpringBank& b, int lane) {
+    const SpringCurve* c = b.curve[lane];
+    int final = RenderQuantize(b.target[lane]);
+    for (int k = CURVE_SAMPLES - 1; k >= 0; k--) {
+        float v = b.target[lane] + b.startPos[lane] * c->s[k].pos + b.startVel[lane] * c->s[k].posV;
+        if (v < b.lo[lane]) v = b.lo[lane];
+        if (v > b.hi[lane]) v = b.hi[lane];
+        if (RenderQuantize(v) != final) return (float)(k + 1) / c->invStep;
+    }
+    return 0.0f;
+}
+
+// 当前段在段内时刻 t 的值 (已钳制，未量化)，按曲线前瞻，不改变通道状态
+float BankValueAt(const SpringBank& b, int lane, float t) {
+    const SpringCurve* c = b.curve[lane];
+    if (!c || t >= b.settleTime[lane]) return b.target[lane];
+    float fi = (t > 0.0f ? t : 0.0f) * c->invStep;
+    if (fi >= (float)(CURVE_SAMPLES - 1)) return b.target[lane];
+    int k = (int)fi;
+    float f = fi - (float)k;
+    const CurveSample& s0 = c->s[k];
+    const CurveSample& s1 = c->s[k + 1];
+    float x = b.target[lane] + b.startPos[lane] * (s0.pos + (s1.pos - s0.pos) * f) + b.startVel[lane] * (s0.posV + (s1.posV - s0.posV) * f);
+    if (x < b.lo[lane]) x = b.lo[lane];
+    if (x > b.hi[lane]) x = b.hi[lane];
+    return x;
+}
+
+// 直接设定通道的位置：丢弃当前动画段与插值历史
+void BankSet(SpringBank& b, int lane, float value) {
+    b.pos[lane] = value;
+    b.prev[lane] = value;
+    b.vel[lane] = 0.0f;
+    b.spring[lane] = NULL;
+#ifdef SPRING_FIXED_POINT
+    b.qPos[lane] = b.qPrev[lane] = FixedFromFloat(value, FIXED_VALUE_SHIFT);
+#endif
+}
+
+// 目标或弹簧发生变化时，以当前位置与速度为起点开始新的一段
+void BankRetarget(SpringBank& b, int lane, float target, const SpringParams& p) {
+    if (b.spring[lane] == &p && b.target[lane] == target) return;
+    b.spring[lane] = &p;
+    b.curve[lane] = p.enabled ? FindSpringCurve(p) : NULL; // 禁用的通道没有曲线，直接吸附到目标
+    b.target[lane] = target;
+    b.startPos[lane] = b.pos[lane] - target;
+    b.startVel[lane] = b.vel[lane];
+    b.elapsed[lane] = 0.0f;
+    b.settleTime[lane] = b.curve[lane] ? BankSettleTime(b, lane) : 0.0f;
+#ifdef SPRING_FIXED_POINT
+    BankSyncFixed(b, lane);
+#endif
+}
+
+// 让通道成为另一通道的线性映射 (value = src * gain + offset)，共用同一条曲线。
+// 映射后的量化粒度不同，静止时刻需单独计算，仅在源通道起段或映射变化时重算
+void BankFollow(SpringBank& b, int lane, int src, float gain, float offset) {
+    float target = b.target[src] * gain + offset;
+    float startPos = b.startPos[src] * gain;
+    float startVel = b.startVel[src] * gain;
+    bool changed = (b.curve[lane] != b.curve[src] || b.target[lane] != target ||
+        b.startPos[lane] != startPos || b.startVel[lane] != startVel);
+
+    b.spring[lane] = b.spring[src];
+    b.curve[lane] = b.curve[src];
+    b.target[lane] = target;
+    b.startPos[lane] = startPos;
+    b.startVel[lane] = startVel;
+    b.elapsed[lane] = b.elapsed[src];
+    if (changed) b.settleTime[lane] = b.curve[lane] ? BankSettleTime(b, lane) : 0.0f;
+#ifdef SPRING_FIXED_POINT
+    if (changed) BankSyncFixed(b, lane);
+    b.elapsedUs[lane] = b.elapsedUs[src];
+#endif
+}
+
+#ifdef SPRING_FIXED_POINT
+// 起段时把段参数换算为定点；取值范围由 StepPhysics 直接以定点设定
+void BankSyncFixed(SpringBank& b, int lane) {
+    b.qTarget[lane] = FixedFromFloat(b.target[lane], FIXED_VALUE_SHIFT);
+    b.qStartPos[lane] = FixedFromFloat(b.startPos[lane], FIXED_VALUE_SHIFT);
+    b.qStartVel[lane] = FixedFromFloat(b.startVel[lane], FIXED_VALUE_SHIFT);
+    b.elapsedUs[lane] = FixedFromFloat(b.elapsed[lane] * 1e6, 0);
+    b.settleUs[lane] = FixedFromFloat(b.settleTime[lane] * 1e6, 0);
+}
+
+// 定点内核：查表、插值、叠加与钳制全部为整数运算，浮点字段只作为结果镜像写回
+void BankStep(SpringBank& b, float dt) {
+    static const CurveSampleQ REST_SAMPLE = { 0, 0, 0, 0 };
+    int dtUs = (int)(dt * 1e6f + 0.5f);
+
+    for (int i = 0; i < BANK_LANES; i++) {
+        b.qPrev[i] = b.qPos[i];
+        b.prev[i] = b.pos[i];
+        if (b.elapsedUs[i] < FIXED_ELAPSED_CAP) b.elapsedUs[i] += dtUs;
+
+        const CurveSampleQ* sa = &REST_SAMPLE;
+        const CurveSampleQ* sb = &REST_SAMPLE;
+        long long frac = 0;
+        const SpringCurve* c = b.curve[i];
+        if (c && b.elapsedUs[i] < b.settleUs[i]) {
+            long long fi = (b.elapsedUs[i] * c->invStepQ) >> (32 - FIXED_CURVE_SHIFT); // 采样序号 (Q16)
+            int k = (int)(fi >> FIXED_CURVE_SHIFT);
+            if (k < CURVE_SAMPLES - 1) {
+                sa = &c->q[k];
+                sb = &c->q[k + 1];
+                frac = fi & ((1 << FIXED_CURVE_SHIFT) - 1);
+            }
+        }
+
+        long long pos = sa->pos + (((sb->pos - sa->pos) * frac) >> FIXED_CURVE_SHIFT);
+        long long vel = sa->vel + (((sb->vel - sa->vel) * frac) >> FIXED_CURVE_SHIFT);
+        long long posV = sa->posV + (((sb->posV - sa->posV) * frac) >> FIXED_CURVE_SHIFT);
+        long long velV = sa->velV + (((sb->velV - sa->velV) * frac) >> FIXED_CURVE_SHIFT);
+
+        long long x = b.qTarget[i] + ((b.qStartPos[i] * pos + b.qStartVel[i] * posV) >> FIXED_CURVE_SHIFT);
+        if (x < b.qLo[i]) x = b.qLo[i];
+        if (x > b.qHi[i]) x = b.qHi[i];
+        long long v = (b.qStartPos[i] * vel + b.qStartVel[i] * velV) >> FIXED_CURVE_SHIFT;
+        b.qPos[i] = (int)x;
+
+        // 到达目标时镜像取浮点目标本身，保持 pos == target 的判断成立
+        b.pos[i] = (x == b.qTarget[i]) ? b.target[i] : (float)x * (1.0f / (1 << FIXED_VALUE_SHIFT));
+        b.vel[i] = (float)v * (1.0f / (1 << FIXED_VALUE_SHIFT));
+        b.elapsed[i] = (float)b.elapsedUs[i] * 1e-6f;
+    }
+}
+#else
+
+// 一次推进全部通道：逐通道查表取出相邻两个采样点，插值与叠加按 SoA 成组计算
+void BankStep(SpringBank& b, float dt) {
+    static const CurveSample REST_SAMPLE = { 0.0f, 0.0f, 0.0f, 0.0f }; // 已静止/无曲线的通道取零响应，即停在目标
+    const CurveSample* sa[BANK_LANES];
+    const CurveSample* sb[BANK_LANES];
+    float frac[BANK_LANES];
+
+    for (int i = 0; i < BANK_LANES; i++) {
+        b.prev[i] = b.pos[i];
+        b.elapsed[i] += dt;
+        sa[i] = sb[i] = &REST_SAMPLE;
+        frac[i] = 0.0f;
+
+        const SpringCurve* c = b.curve[i];
+        if (!c || b.elapsed[i] >= b.settleTime[i]) continue;
+        float fi = b.elapsed[i] * c->invStep;
+        if (fi >= (float)(CURVE_SAMPLES - 1)) continue;
+        int k = (int)fi;
+        sa[i] = &c->s[k];
+        sb[i] = &c->s[k + 1];
+        frac[i] = fi - (float)k;
+    }
+
+#ifdef SPRING_BANK_SSE
+    // 每个采样点恰好 4 个 float，转置后得到 pos/vel/posV/velV 四个通道向量
+    __m128 a0 = _mm_loadu_ps(&sa[0]->pos), a1 = _mm_loadu_ps(&sa[1]->pos);
+    __m128 a2 = _mm_loadu_ps(&sa[2]->pos), a3 = _mm_loadu_ps(&sa[3]->pos);
+    __m128 b0 = _mm_loadu_ps(&sb[0]->pos), b1 = _mm_loadu_ps(&sb[1]->pos);
+    __m128 b2 = _mm_loadu_ps(&sb[2]->pos), b3 = _mm_loadu_ps(&sb[3]->pos);
+    _MM_TRANSPOSE4_PS(a0, a1, a2, a3);
+    _MM_TRANSPOSE4_PS(b0, b1, b2, b3);
+
+    __m128 f = _mm_loadu_ps(frac);
+    __m128 pos = _mm_add_ps(a0, _mm_mul_ps(_mm_sub_ps(b0, a0), f));
+    __m128 vel = _mm_add_ps(a1, _mm_mul_ps(_mm_sub_ps(b1, a1), f));
+    __m128 posV = _mm_add_ps(a2, _mm_mul_ps(_mm_sub_ps(b2, a2), f));
+    __m128 velV = _mm_add_ps(a3, _mm_mul_ps(_mm_sub_ps(b3, a3), f));
+
+    __m128 sp = _mm_load_ps(b.startPos);
+    __m128 sv = _mm_load_ps(b.startVel);
+    __m128 x = _mm_add_ps(_mm_load_ps(b.target), _mm_add_ps(_mm_mul_ps(sp, pos), _mm_mul_ps(sv, posV)));
+    x = _mm_min_ps(_mm_max_ps(x, _mm_load_ps(b.lo)), _mm_load_ps(b.hi));
+    _mm_store_ps(b.pos, x);
+    _mm_store_ps(b.vel, _mm_add_ps(_mm_mul_ps(sp, vel), _mm_mul_ps(sv, velV)));
+#else
+    for (int i = 0; i < BANK_LANES; i++) {
+        const CurveSample& a = *sa[i];
+        const CurveSample& c = *sb[i];
+        float pos = a.pos + (c.pos - a.pos) * frac[i];
+        float vel = a.vel + (c.vel - a.vel) * frac[i];
+        float posV = a.posV + (c.posV - a.posV) * frac[i];
+        float velV = a.velV + (c.velV - a.velV) * frac[i];
+        float x = b.target[i] + b.startPos[i] * pos + b.startVel[i] * posV;
+        if (x < b.lo[i]) x = b.lo[i];
+        if (x > b.hi[i]) x = b.hi[i];
+        b.pos[i] = x;
+        b.vel[i] = b.startPos[i] * vel + b.startVel[i] * velV;
+    }
+#endif
+}
+#endif // SPRING_FIXED_POINT
+
+// 以下例程按配置中位置 (Motion) 与透明度 (Opacity) 通道是否启用特化，
+// 两个方向都禁用的通道在编译期消除，不再逐帧判断 enabled
+
+// 当前启用的弹簧中最小的 maxStep：慢弹簧每帧一步，快弹簧在长帧中自动拆成多步
+template <bool Motion, bool Opacity>
+float ActivePhysicsStepT() {
+    const AnimSnapshot& v = g_Render.view;
+    float step = PHYSICS_STEP_MAX;
+    if (Motion) {
+        const SpringParams& p = v.isHidden ? v.cfg->motionOut : v.cfg->motionIn;
+        if (p.enabled && p.maxStep < step) step = p.maxStep;
+    }
+    if (Opacity) {
+        const SpringParams& p = v.isHidden ? v.cfg->opacityOut : v.cfg->opacityIn;
+        if (p.enabled && p.maxStep < step) step = p.maxStep;
+    }
+    return step;
+}
+
+float ActivePhysicsStep() {
+    return g_Render.physics->stepSize();
+}
+
+// 累加器使用的步长，取整到微秒
+LONGLONG ActivePhysicsStepUs() {
+    return (LONGLONG)(ActivePhysicsStep() * 1e6f + 0.5f);
+}
+
+// 推进一个物理步。只依赖步长与目标，给定相同的帧时间序列时结果逐位一致
+template <bool Motion, bool Opacity>
+void StepPhysicsT(float dt) {
+    const AnimSnapshot& v = g_Render.view;
+    g_Render.bank.lo[LANE_Y] = -FLT_MAX;    g_Render.bank.hi[LANE_Y] = FLT_MAX;
+    g_Render.bank.lo[LANE_ALPHA] = 0.0f;    g_Render.bank.hi[LANE_ALPHA] = 255.0f;
+    g_Render.bank.lo[LANE_MASK] = 0.0f;     g_Render.bank.hi[LANE_MASK] = (float)v.maxMaskAlpha;
+#ifdef SPRING_FIXED_POINT
+    g_Render.bank.qLo[LANE_Y] = -FIXED_LIMIT; g_Render.bank.qHi[LANE_Y] = FIXED_LIMIT;
+    g_Render.bank.qLo[LANE_ALPHA] = 0;        g_Render.bank.qHi[LANE_ALPHA] = 255 << FIXED_VALUE_SHIFT;
+    g_Render.bank.qLo[LANE_MASK] = 0;         g_Render.bank.qHi[LANE_MASK] = v.maxMaskAlpha << FIXED_VALUE_SHIFT;
+#endif
+
+    // 禁用的通道使用 SP_OFF：没有曲线，目标不变时 BankRetarget 直接返回
+    BankRetarget(g_Render.bank, LANE_Y, v.targetY, Motion ? (v.isHidden ? v.cfg->motionOut : v.cfg->motionIn) : SP_OFF);
+    BankRetarget(g_Render.bank, LANE_ALPHA, v.targetAlpha, Opacity ? (v.isHidden ? v.cfg->opacityOut : v.cfg->opacityIn) : SP_OFF);
 
-    // 构建动态更新菜单项
-    TCHAR szUpdateText[128];
-    UINT uUpdateFlags = MF_STRING;
+    // 蒙版透明度跟随透明度通道；透明度禁用时跟随位置 (完全露出时最浓，完全收起时为 0)
+    if (Opacity) BankFollow(g_Render.bank, LANE_MASK, LANE_ALPHA, v.maxMaskAlpha / 255.0f, 0.0f);
+    else BankFollow(g_Render.bank, LANE_MASK, LANE_Y, -(float)v.maxMaskAlpha / (float)v.screenH, (float)v.maxMaskAlpha);
 
-    if (g_UpdateCtx.status == US_UPDATE_FOUND) {
-        _tcscpy_s(szUpdateText, _countof(szUpdateText), _T("已检测到更新版本，点击跳转至下载页面"));
+    BankStep(g_Render.bank, dt);
+}
+
+void StepPhysics(float dt) {
+    g_Render.physics->step(dt);
+}
+
+// 推进物理并求出本帧的渲染值 (已插值，未量化)，不提交到窗口
+void AdvancePhysics(float dt, float* render) {
+    const AnimSnapshot& v = g_Render.view;
+    // 步长随当前弹簧而定，对同一配置始终固定。每一步推进的时长恰为整数微秒，与累加器一致
+    LONGLONG stepUs = ActivePhysicsStepUs();
+    float step = (float)stepUs * 1e-6f;
+
+    if (dt <= 0.0f) {
+        // 零步长：立即同步到当前目标 (禁用通道直接到位)，不做插值
+        StepPhysics(0.0f);
+        for (int i = 0; i < BANK_LANES; i++) g_Render.bank.prev[i] = g_Render.bank.pos[i];
+#ifdef SPRING_FIXED_POINT
+        for (int i = 0; i < BANK_LANES; i++) g_Render.bank.qPrev[i] = g_Render.bank.qPos[i];
+#endif
+        g_Render.physicsAccumulatorUs = 0;
     }
     else {
-        _tcscpy_s(szUpdateText, _countof(szUpdateText), _T("正在检查新版本..."));
-        uUpdateFlags |= MF_GRAYED;
+        // 状态切换期间加速物理模拟
+        if (v.accelerated) dt *= STARTUP_SPEED_FACTOR;
+
+        // 固定步长累加器，以整数微秒计：帧时间只决定推进多少步，不影响每一步的结果。
+        // 帧时间先取整到微秒，同样的总时长无论怎样分帧，推进的步数与余量都相同，轨迹逐位一致
+        g_Render.physicsAccumulatorUs += (LONGLONG)((double)dt * 1e6 + 0.5);
+        while (g_Render.physicsAccumulatorUs >= stepUs) {
+            StepPhysics(step);
+            g_Render.physicsAccumulatorUs -= stepUs;
+        }
     }
-    AppendMenu(hMenu, uUpdateFlags, ID_TRAY_UPDATE, szUpdateText);
-    AppendMenu(hMenu, MF_SEPARATOR, 0, NULL);
 
-    // 动画模式子菜单
-    HMENU hSubProfile = CreatePopupMenu();
-    for (int i = 0; i < PRESET_COUNT; i++) {
-        UINT flags = MF_STRING;
-        int checkIndex = g.hasPendingCfg ? g.pendingCfgIndex : g.cfgIndex;
-        if (i == checkIndex) flags |= MF_CHECKED;
-        AppendMenu(hSubProfile, flags, ID_PROFILE_START + i, PRESETS[i].name);
+    // 在上一步与当前步之间插值渲染；已到达目标的通道直接取目标值
+#ifdef SPRING_FIXED_POINT
+    long long blendQ = (g_Render.physicsAccumulatorUs << FIXED_CURVE_SHIFT) / stepUs;
+    for (int i = 0; i < BANK_LANES; i++) {
+        const SpringBank& b = g_Render.bank;
+        int q = (b.qPos[i] == b.qTarget[i]) ? b.qPos[i] : b.qPrev[i] + (int)(((long long)(b.qPos[i] - b.qPrev[i]) * blendQ) >> FIXED_CURVE_SHIFT);
+        render[i] = (q == b.qTarget[i]) ? b.target[i] : (float)q * (1.0f / (1 << FIXED_VALUE_SHIFT)); // Q8 值可被浮点精确表示，量化结果与整数舍入一致
     }
-    AppendMenu(hMenu, MF_POPUP, (UINT_PTR)hSubProfile, _T("动画模式 (Animation Mode)"));
+#else
+    float blend = (float)g_Render.physicsAccumulatorUs / (float)stepUs;
+    for (int i = 0; i < BANK_LANES; i++) {
+        const SpringBank& b = g_Render.bank;
+        render[i] = (b.pos[i] == b.target[i]) ? b.pos[i] : b.prev[i] + (b.pos[i] - b.prev[i]) * blend;
+    }
+#endif
+}
 
-    // 蒙版子菜单
-    HMENU hSubMask = CreatePopupMenu();
-    for (int i = 0; i < MASK_OPT_COUNT; i++) {
-        UINT flags = MF_STRING;
-        int checkIndex = g.hasPendingMask ? g.pendingMaskOptIndex : g.maskOptIndex;
-        if (i == checkIndex) flags |= MF_CHECKED;
+// 推进并立即提交，用于非流水线的场合 (强制同步、热切换等)
+void UpdatePhysics(float dt) {
+    const AnimSnapshot& v = g_Render.view;
+    if (!v.hContainer) return;
+    float render[BANK_LANES];
+    AdvancePhysics(dt, render);
+    ApplyAnimation(render[LANE_Y], render[LANE_ALPHA], render[LANE_MASK]);
+    g_Render.framePending = false; // 预先算好的帧已过时
+}
 
-        TCHAR buf[64] = { 0 };
-        if (MASK_OPTIONS[i].percent == 0) _tcscpy_s(buf, _countof(buf), _T("关闭 (Off)"));
-        else _stprintf_s(buf, _countof(buf), _T("%d%% 浓度 (Opacity)"), MASK_OPTIONS[i].percent);
+// 将渲染值提交到窗口
+void ApplyAnimation(float y, float alpha, float maskAlpha) {
+    const AnimSnapshot& v = g_Render.view;
+    int renderY = RenderQuantize(y);
+    int renderAlpha = RenderQuantize(alpha);
 
-        AppendMenu(hSubMask, flags, ID_MASK_START + i, buf);
+    // 仅在值发生变化时调用 WinAPI，减少开销
+    if (renderY != g_Render.lastRenderY) {
+        PerfCount(PC_SETWINDOWPOS);
+        SetWindowPos(v.hContainer, NULL, 0, renderY, 0, 0, SWP_NOSIZE | SWP_NOZORDER | SWP_NOACTIVATE);
+        if (v.hMaskWindow && IsWindow(v.hMaskWindow) && IsWindowVisible(v.hMaskWindow)) {
+            int extendedH = (int)(v.screenH * 1.04f);
+            int offsetY = (int)(v.screenH * 0.02f);
+            PerfCount(PC_SETWINDOWPOS);
+            SetWindowPos(v.hMaskWindow, NULL, 0, renderY - offsetY, v.screenW, extendedH, SWP_NOZORDER | SWP_NOACTIVATE);
+        }
+        g_Render.lastRenderY = renderY;
     }
-    AppendMenu(hMenu, MF_POPUP, (UINT_PTR)hSubMask, _T("背景蒙版 (Background Mask)"));
 
-    AppendMenu(hMenu, MF_SEPARATOR, 0, NULL);
+    if (renderAlpha != g_Render.lastRenderAlpha) {
+        PerfCount(PC_SETLAYERED);
+        SetLayeredWindowAttributes(v.hContainer, 0, (BYTE)renderAlpha, LWA_ALPHA);
+        g_Render.lastRenderAlpha = renderAlpha;
+    }
 
-    // 开机自启
-    UINT autoStartFlags = MF_STRING;
-    if (IsAutoStartEnabled()) autoStartFlags |= MF_CHECKED;
-    AppendMenu(hMenu, autoStartFlags, ID_TRAY_AUTOSTART, _T("开机自启 (Auto Start)"));
+    // 蒙版透明度联动
+    if (v.hMaskWindow && IsWindow(v.hMaskWindow) && IsWindowVisible(v.hMaskWindow) && v.maxMaskAlpha > 0) {
+        int maskCurrentAlpha = RenderQuantize(maskAlpha);
+        if (maskCurrentAlpha != g_Render.lastMaskAlpha) {
+            PerfCount(PC_SETLAYERED);
+            SetLayeredWindowAttributes(v.hMaskWindow, 0, (BYTE)maskCurrentAlpha, LWA_ALPHA);
+            g_Render.lastMaskAlpha = maskCurrentAlpha;
+        }
+    }
 
-    AppendMenu(hMenu, MF_SEPARATOR, 0, NULL);
-    AppendMenu(hMenu, MF_STRING, ID_TRAY_EXIT, _T("退出程序 (Exit)"));
+    // 周期性维护 Z-Order，防止被其他全屏应用覆盖
+    g_Render.zOrderGuardCounter++;
+    if (g_Render.zOrderGuardCounter > 30) {
+        EnforceZOrder(v.hContainer, v.hMaskWindow);
+        g_Render.zOrderGuardCounter = 0;
+    }
+}
 
-    TrackPopupMenu(hMenu, TPM_BOTTOMALIGN | TPM_LEFTALIGN, p.x, p.y, 0, hwnd, NULL);
+bool IsChannelIdle(int lane, float target, const SpringParams& p) {
+    const SpringBank& b = g_Render.bank;
+    if (!p.enabled) return true;
+    // 当前段已起段：直接比较预测的静止时刻
+    if (b.spring[lane] == &p && b.target[lane] == target) return b.elapsed[lane] >= b.settleTime[lane];
+    // 目标刚变化尚未起段：退回阈值判断
+    return fabs(target - b.pos[lane]) < 1.0f && fabs(b.vel[lane]) < 2.0f;
+}
 
-    g_UpdateCtx.hActiveMenu = NULL;
-    DestroyMenu(hMenu);
+template <bool Motion, bool Opacity>
+bool IsPhysicsIdleT() {
+    const AnimSnapshot& v = g_Render.view;
+    if (Motion && !IsChannelIdle(LANE_Y, v.targetY, v.isHidden ? v.cfg->motionOut : v.cfg->motionIn)) return false;
+    if (Opacity && !IsChannelIdle(LANE_ALPHA, v.targetAlpha, v.isHidden ? v.cfg->opacityOut : v.cfg->opacityIn)) return false;
+    // 蒙版通道的量化粒度与源通道不同，单独判断
+    return !g_Render.bank.curve[LANE_MASK] || g_Render.bank.elapsed[LANE_MASK] >= g_Render.bank.settleTime[LANE_MASK];
 }
 
-// --- 消息处理 ---
+bool IsPhysicsIdle() {
+    return g_Render.physics->idle();
+}
 
-LRESULT CALLBACK MsgWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
-    if (msg == g_uMsgTaskbarCreated && g_uMsgTaskbarCreated != 0) {
-        g.hContainer = NULL; // 任务栏重启需重新定位桌面
-        return 0;
+#define PHYSICS_ROUTINE(m, o) { ActivePhysicsStepT<m, o>, StepPhysicsT<m, o>, IsPhysicsIdleT<m, o> }
+const PhysicsRoutines PHYSICS_ROUTINES[4] = {
+    PHYSICS_ROUTINE(false, false), PHYSICS_ROUTINE(false, true),
+    PHYSICS_ROUTINE(true, false), PHYSICS_ROUTINE(true, true)
+};
+#undef PHYSICS_ROUTINE
+
+// 渲染线程每次取到快照后调用
+void SelectPhysicsRoutines() {
+    const AnimSnapshot& v = g_Render.view;
+    bool motion = v.cfg->motionIn.enabled || v.cfg->motionOut.enabled;
+    bool opacity = v.cfg->opacityIn.enabled || v.cfg->opacityOut.enabled;
+    g_Render.physics = &PHYSICS_ROUTINES[(motion ? 2 : 0) | (opacity ? 1 : 0)];
+}
+
+// 距离动画结束的剩余时间 (秒)。目标刚变化尚未起段时返回 -1，表示需要先推进一帧
+float PhysicsTimeToSettle() {
+    const AnimSnapshot& v = g_Render.view;
+    const SpringParams* pMotion = v.isHidden ? &v.cfg->motionOut : &v.cfg->motionIn;
+    const SpringParams* pOpacity = v.isHidden ? &v.cfg->opacityOut : &v.cfg->opacityIn;
+    const SpringParams* params[2] = { pMotion, pOpacity };
+    const int lanes[2] = { LANE_Y, LANE_ALPHA };
+    const float targets[2] = { v.targetY, v.targetAlpha };
+
+    float remaining = 0.0f;
+    for (int i = 0; i < 2; i++) {
+        if (!params[i]->enabled) continue;
+        int lane = lanes[i];
+        if (g_Render.bank.spring[lane] != params[i] || g_Render.bank.target[lane] != targets[i]) return -1.0f;
+        float left = g_Render.bank.settleTime[lane] - g_Render.bank.elapsed[lane];
+        if (left > remaining) remaining = left;
     }
-    switch (msg) {
-    case WM_TRAYICON:
-        if (lParam == WM_RBUTTONUP) {
-            ForceShowImmediate();
-            ShowTrayMenu(hwnd);
-            TimerGetDelta(true);
-        }
-        break;
+    return remaining;
+}
 
-        // 响应后台线程的刷新请求
-    case WM_UPDATE_UI_REFRESH:
-        RefreshMenuText();
-        break;
+// --- 渲染线程实现 ---
+
+// 由逻辑线程的当前状态生成快照，内容与上次发布的相同时不发布
+void PublishAnimSnapshot() {
+    AnimSnapshot s;
+    memset(&s, 0, sizeof(s)); // 填充字节也清零，整体比较才有意义
+    s.seq = g.published.seq;
+    s.cfg = g.cfg;
+    s.targetY = g.targetY;
+    s.targetAlpha = g.targetAlpha;
+    s.isHidden = g.isHidden;
+    s.accelerated = (g.startupState != STARTUP_NORMAL);
+    s.quit = g.renderQuit;
+    s.maxMaskAlpha = g.maxMaskAlpha;
+    s.screenW = g.screenW;
+    s.screenH = g.screenH;
+    s.frameCapIndex = g.frameCapIndex;
+    s.hContainer = g.hContainer;
+    s.hMaskWindow = g.hMaskWindow;
+    s.jumpSeq = g.jumpSeq;
+    s.jumpY = g.jumpY;
+    s.jumpAlpha = g.jumpAlpha;
+    s.resyncSeq = g.resyncSeq;
+    s.displaySeq = g.displaySeq;
+    s.flightSaveSeq = g.flightSaveSeq;
+    if (memcmp(&s, &g.published, sizeof(s)) == 0) return;
+
+    s.seq++;
+    memcpy(&g.published, &s, sizeof(s));
+    memcpy(&g_AnimSnapshots.Write(), &s, sizeof(s));
+    g_AnimSnapshots.Publish();
+    g_Render.wake.Notify();
+}
 
-    case WM_WTSSESSION_CHANGE:
-        if (wParam == WTS_SESSION_LOCK) g.isPaused = true;
-        else if (wParam == WTS_SESSION_UNLOCK) {
-            g.isPaused = false;
-            g.lastActiveTime = GetTickCount64();
-            TimerGetDelta(true);
-        }
-        break;
+// 渲染线程最近一次发布的状态
+const RenderStatus& LatestRenderStatus() {
+    g_RenderStatus.Consume();
+    return g_RenderStatus.Read();
+}
 
-    case WM_COMMAND: {
-        int cmdId = LOWORD(wParam);
-        if (cmdId == ID_TRAY_EXIT) {
-            g.appRunning = false;
-            PerformExitSequence();
-        }
-        else if (cmdId == ID_TRAY_AUTOSTART) {
-            SetAutoStart(!IsAutoStartEnabled());
-        }
-        else if (cmdId == ID_TRAY_UPDATE) {
-            // 点击更新跳转
-            if (g_UpdateCtx.status == US_UPDATE_FOUND && g_UpdateCtx.fastestUrl[0] != 0) {
-                ShellExecute(NULL, _T("open"), g_UpdateCtx.fastestUrl, NULL, NULL, SW_SHOW);
-            }
+// 渲染线程已应用最新的快照，且动画已静止
+bool RenderIdle() {
+    const RenderStatus& s = LatestRenderStatus();
+    return s.seq == g.published.seq && s.idle;
+}
+
+// 渲染线程：取最新的快照并处理其中的一次性请求，返回是否有更新
+bool RenderSync() {
+    if (!g_AnimSnapshots.Consume()) return false;
+    RenderContext& r = g_Render;
+    const AnimSnapshot& s = g_AnimSnapshots.Read();
+    int oldCap = r.view.frameCapIndex;
+    r.view = s;
+
+    // 每次都按配置内容重新选择：配置可能被原地修改 (/tune 在同一个对象上逐个替换候选参数)，只比较指针会沿用旧的内核
+    SelectPhysicsRoutines();
+    if (s.frameCapIndex != oldCap) r.pacer.nextDue = 0; // 帧率上限不影响曲线，下一帧即生效
+    if (s.displaySeq != r.displaySeq) {
+        r.displaySeq = s.displaySeq;
+        r.pacer.timingValid = false;
+    }
+    if (s.jumpSeq != r.jumpSeq) {
+        r.jumpSeq = s.jumpSeq;
+        BankSet(r.bank, LANE_Y, s.jumpY);
+        BankSet(r.bank, LANE_ALPHA, s.jumpAlpha);
+        r.physicsAccumulatorUs = 0;
+        r.framePending = false;
+    }
+    if (s.resyncSeq != r.resyncSeq) {
+        r.resyncSeq = s.resyncSeq;
+        r.lastRenderY = -99999; r.lastRenderAlpha = -1; r.lastMaskAlpha = -1;
+        TimerGetDelta(true);
+        UpdatePhysics(0.0f);
+    }
+    if (s.flightSaveSeq != r.flightSaveSeq) {
+        r.flightSaveSeq = s.flightSaveSeq;
+        FlightSave(FLIGHT_REASON_MANUAL);
+    }
+    return true;
+}
+
+// 渲染线程：发布当前位置与是否静止
+void PublishRenderStatus(bool idle) {
+    RenderStatus& s = g_RenderStatus.Write();
+    s.seq = g_Render.view.seq;
+    s.idle = idle;
+    s.y = g_Render.bank.pos[LANE_Y];
+    s.alpha = g_Render.bank.pos[LANE_ALPHA];
+    g_RenderStatus.Publish();
+}
+
+// 物理更新步进：流水线方式，垂直同步返回后只提交预先算好的值，
+// 下一帧的计算与下一次等待重叠，计算时刻取该帧的预计呈现时刻。静止后等待逻辑线程发布新快照
+void RenderThreadProc() {
+    RenderContext& r = g_Render;
+    PerfNameThread(_T("render"));
+    TimerGetDelta(true);
+    for (;;) {
+        LONGLONG frameStart = g_Clock->counter();
+        FlightBeginFrame();
+        RenderSync();
+        if (r.view.quit) break;
+
+        if (r.framePending) {
+            ApplyAnimation(r.frameRender[LANE_Y], r.frameRender[LANE_ALPHA], r.frameRender[LANE_MASK]);
+            r.framePending = false;
         }
-        else if (cmdId >= ID_PROFILE_START && cmdId < ID_PROFILE_START + PRESET_COUNT) {
-            g.pendingCfgIndex = cmdId - ID_PROFILE_START;
-            g.hasPendingCfg = true;
-            TriggerRestartAnimation();
+        if (r.view.hContainer && !IsPhysicsIdle()) {
+            LONGLONG applied = g_Clock->counter();
+            float dt = TimerAdvanceTo(PlanFrame());
+            AdvancePhysics(dt, r.frameRender);
+            r.framePending = true;
+            PublishRenderStatus(false);
+            LONGLONG computed = g_Clock->counter();
+            WaitForFrame(); // 垂直同步等待
+            FlightEndFrame(frameStart, applied, computed, dt);
         }
-        else if (cmdId >= ID_MASK_START && cmdId < ID_MASK_START + MASK_OPT_COUNT) {
-            g.pendingMaskOptIndex = cmdId - ID_MASK_START;
-            g.hasPendingMask = true;
-            TriggerRestartAnimation();
+        else {
+            EndFramePacing();
+            FlightEndAnimation();
+            if (r.bank.pos[LANE_Y] != r.view.targetY || r.bank.pos[LANE_ALPHA] != r.view.targetAlpha) UpdatePhysics(0.0f);
+            PublishRenderStatus(true);
+            PostMessage(g.hMsgWindow, WM_RENDER_IDLE, 0, 0);
+            r.wake.Wait();
+            PerfCount(PC_WAKEUP);
+            TimerGetDelta(true);
         }
-        break;
     }
-    case WM_DISPLAYCHANGE:
-        Sleep(500);
-        g.hContainer = NULL;
-        break;
-    case WM_DESTROY:
-        g.appRunning = false;
-        return 0;
+}
+
+// 线程本身使用 std::thread，以便在其他平台上用 ThreadSanitizer 检查；Win32 特有的只有下面两处
+void RaiseThreadPriority(std::thread& t) {
+    SetThreadPriority((HANDLE)t.native_handle(), THREAD_PRIORITY_ABOVE_NORMAL);
+}
+
+// 等待线程结束。该线程可能正在向本线程创建的窗口发送消息，等待期间继续处理发来的消息
+void JoinThreadPumpingMessages(std::thread& t) {
+    HANDLE hThread = (HANDLE)t.native_handle();
+    while (MsgWaitForMultipleObjects(1, &hThread, FALSE, INFINITE, QS_SENDMESSAGE) == WAIT_OBJECT_0 + 1) {
+        MSG msg;
+        PeekMessage(&msg, NULL, 0, 0, PM_NOREMOVE | PM_QS_SENDMESSAGE);
     }
-    return DefWindowProc(hwnd, msg, wParam, lParam);
+    t.join();
 }
 
-// --- 基础工具实现 ---
+bool StartRenderThread() {
+    g_Render.hFrameTimer = CreateWaitableTimerEx(NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+    if (!g_Render.hFrameTimer) g_Render.hFrameTimer = CreateWaitableTimer(NULL, FALSE, NULL); // Win10 1803 之前不支持高精度定时器
 
-void TimerInit() {
-    QueryPerformanceFrequency(&qpcFreq);
-    QueryPerformanceCounter(&qpcLastTime);
+    PublishAnimSnapshot(); // 线程启动时即有完整的快照可取
+    try {
+        g_Render.thread = std::thread(RenderThreadProc);
+    }
+    catch (const std::system_error&) {
+        return false;
+    }
+    // 进程整体为低优先级，渲染线程略高于逻辑线程，避免帧被其他后台任务挤掉
+    RaiseThreadPriority(g_Render.thread);
+    return true;
 }
 
-float TimerGetDelta(bool resetOnly) {
-    LARGE_INTEGER now;
-    QueryPerformanceCounter(&now);
-    if (resetOnly) {
-        qpcLastTime = now;
-        return 0.0f;
+// 通知渲染线程退出并等待。渲染线程可能正在向本线程创建的遮罩窗口发送消息
+void StopRenderThread() {
+    if (g_Render.thread.joinable()) {
+        g.renderQuit = true;
+        PublishAnimSnapshot();
+        JoinThreadPumpingMessages(g_Render.thread);
     }
-    // 防止除以0（虽然在Win32下几乎不可能发生）
-    if (qpcFreq.QuadPart == 0) return 0.016f;
+    if (g_Render.hFrameTimer) CloseHandle(g_Render.hFrameTimer);
+    g_Render.hFrameTimer = NULL;
+}
+
+// 等渲染线程取走最新的快照并完成一帧：此后它不再使用旧快照中的窗口句柄。
+// 渲染线程此时可能正在向遮罩窗口发送消息，等待期间继续处理发来的消息
+void WaitRenderSnapshotConsumed() {
+    if (!g_Render.thread.joinable()) return; // 基准测试等不启动渲染线程的场合
+    while (LatestRenderStatus().seq != g.published.seq) {
+        if (MsgWaitForMultipleObjects(0, NULL, FALSE, 1, QS_SENDMESSAGE) == WAIT_OBJECT_0) {
+            MSG msg;
+            PeekMessage(&msg, NULL, 0, 0, PM_NOREMOVE | PM_QS_SENDMESSAGE);
+        }
+    }
+}
 
-    float dt = (float)((double)(now.QuadPart - qpcLastTime.QuadPart) / (double)qpcFreq.QuadPart);
-    qpcLastTime = now;
+// --- 帧记录 ---
 
-    // 帧时间钳制，防止Debug断点后物理爆炸
-    if (dt > 0.05f) dt = 0.05f;
-    if (dt < 0.0001f) dt = 0.0001f;
-    return dt;
+// 帧记录文件的路径 (临时目录)
+void FlightRecordPath(TCHAR* szPath, size_t cchPath) {
+    TCHAR szTempPath[MAX_PATH];
+    GetTempPath(MAX_PATH, szTempPath);
+    PathCombine(szPath, szTempPath, FLIGHT_FILE_NAME);
 }
 
-void InitGlobalPaths() {
-    TCHAR szProgramFiles[MAX_PATH];
-    if (SUCCEEDED(SHGetFolderPath(NULL, CSIDL_PROGRAM_FILES, NULL, 0, szProgramFiles))) {
-        PathCombine(g.szInstallDir, szProgramFiles, _T("AutoICON"));
+// 本线程计数块中的当前值，尚未计数过时为 0
+LONG PerfThreadCount(int id) {
+    return t_PerfBlock ? t_PerfBlock->counts[id].load(std::memory_order_relaxed) : 0;
+}
+
+// 渲染线程：记下帧开始时本线程的 Win32 调用计数
+void FlightBeginFrame() {
+    for (int id = 0; id < PC_COUNT; id++) g_Flight.calls[id] = PerfThreadCount(id);
+}
+
+// 渲染线程：一帧 (提交上一帧、推进下一帧、等待垂直同步) 结束时写入环形缓冲
+void FlightEndFrame(LONGLONG start, LONGLONG applied, LONGLONG computed, float dt) {
+    LONGLONG end = g_Clock->counter();
+    double toUs = 1e6 / (double)g_Clock->frequency();
+    FlightFrame& f = g_Flight.frames[g_Flight.count % FLIGHT_FRAMES];
+    f.frame = g_Flight.count;
+    f.intervalUs = g_Flight.lastStart ? (DWORD)((start - g_Flight.lastStart) * toUs) : 0;
+    f.dtUs = (DWORD)(dt * 1e6f);
+    f.applyUs = (DWORD)((applied - start) * toUs);
+    f.physicsUs = (DWORD)((computed - applied) * toUs);
+    f.waitUs = (DWORD)((end - computed) * toUs);
+    f.lateUs = g_Render.pacer.target ? (LONG)((end - g_Render.pacer.target) * toUs) : 0;
+
+    BYTE* calls[4] = { &f.setWindowPos, &f.setLayered, &f.enforceZOrder, &f.timerWaits };
+    const int ids[4] = { PC_SETWINDOWPOS, PC_SETLAYERED, PC_ENFORCEZORDER, PC_WAKEUP };
+    for (int i = 0; i < 4; i++) {
+        LONG n = PerfThreadCount(ids[i]) - g_Flight.calls[ids[i]];
+        *calls[i] = (BYTE)(n > 255 ? 255 : n);
     }
-    else {
-        _tcscpy_s(g.szInstallDir, _countof(g.szInstallDir), _T("C:\\Program Files\\AutoICON"));
+
+    if (f.lateUs > FLIGHT_HITCH_MS * 1000) g_Flight.hitch = true;
+    g_Flight.lastStart = start;
+    g_Flight.count++;
+}
+
+// 渲染线程：动画结束。期间出现过卡顿时保存记录，两次自动保存至少间隔 FLIGHT_AUTOSAVE_GAP_MS
+void FlightEndAnimation() {
+    g_Flight.lastStart = 0;
+    if (!g_Flight.hitch) return;
+    g_Flight.hitch = false;
+    ULONGLONG now = g_Clock->tickMs();
+    if (g_Flight.lastAutoSave != 0 && now - g_Flight.lastAutoSave < FLIGHT_AUTOSAVE_GAP_MS) return;
+    g_Flight.lastAutoSave = now;
+    FlightSave(FLIGHT_REASON_HITCH);
+}
+
+// 渲染线程：按从旧到新的顺序写出缓冲中的帧，完成后通知主线程
+bool FlightSave(int reason) {
+    TCHAR szPath[MAX_PATH];
+    FlightRecordPath(szPath, _countof(szPath));
+
+    FlightFileHeader h = { 0 };
+    h.magic = FLIGHT_MAGIC;
+    h.version = FLIGHT_VERSION;
+    h.frameSize = sizeof(FlightFrame);
+    h.count = g_Flight.count < FLIGHT_FRAMES ? g_Flight.count : FLIGHT_FRAMES;
+    h.periodUs = g_Render.pacer.period > 0 ? (DWORD)(g_Render.pacer.period * 1000000 / g_Clock->frequency()) : 0;
+    h.reason = (DWORD)reason;
+    h.profile = g_Render.view.cfg ? (DWORD)(g_Render.view.cfg - PRESETS) : 0;
+    h.capFps = (DWORD)FRAME_CAP_OPTIONS[g_Render.view.frameCapIndex];
+    h.hitchMs = FLIGHT_HITCH_MS;
+
+    bool ok = false;
+    FILE* fp = NULL;
+    if (_tfopen_s(&fp, szPath, _T("wb")) == 0 && fp) {
+        DWORD first = g_Flight.count - h.count;
+        DWORD head = first % FLIGHT_FRAMES;
+        DWORD tail = (h.count < FLIGHT_FRAMES - head) ? h.count : FLIGHT_FRAMES - head;
+        ok = fwrite(&h, sizeof(h), 1, fp) == 1 &&
+            fwrite(&g_Flight.frames[head], sizeof(FlightFrame), tail, fp) == tail &&
+            fwrite(&g_Flight.frames[0], sizeof(FlightFrame), h.count - tail, fp) == h.count - tail;
+        fclose(fp);
     }
-    PathCombine(g.szInstallExePath, g.szInstallDir, EXE_NAME);
+    if (g.hMsgWindow) PostMessage(g.hMsgWindow, WM_FLIGHT_SAVED, (WPARAM)reason, ok ? 1 : 0);
+    return ok;
 }
 
-// --- 物理引擎实现 ---
+// --- 物理基准测试 ---
+
+// 无窗口运行所需的状态：烘焙曲线并使用固定的屏幕尺寸
+// 解析命令行工具的参数：mode 之后依次是 argCount 个数值 (缺省为 0) 与可选的输出文件 (可带引号)。
+// 命令行中没有 mode 时返回 false
+bool ParseToolCommand(const TCHAR* cmdLine, const TCHAR* mode, float* args, int argCount, TCHAR* outPath, size_t cchPath) {
+    const TCHAR* found = _tcsstr(cmdLine, mode);
+    if (!found) return false;
+
+    TCHAR* p = (TCHAR*)found + _tcslen(mode);
+    for (int i = 0; i < argCount; i++) args[i] = (float)_tcstod(p, &p);
+    while (*p == _T(' ') || *p == _T('"')) p++;
+    _tcscpy_s(outPath, cchPath, p);
+    size_t len = _tcslen(outPath);
+    while (len > 0 && (outPath[len - 1] == _T(' ') || outPath[len - 1] == _T('"'))) outPath[--len] = 0;
+    return true;
+}
 
-void SolveSpring(float& current, float& velocity, float target, const SpringParams& p, float dt) {
-    float displacement = current - target;
-    float acceleration = -p.tension * displacement - p.friction * velocity;
-    velocity += acceleration * dt;
-    current += velocity * dt;
+void BenchInit() {
+    BakeSpringCurves();
+    g.screenW = BENCH_SCREEN_W;
+    g.screenH = BENCH_SCREEN_H;
+    g.maxMaskAlpha = BENCH_MASK_ALPHA;
+}
 
-    // 浮点数安全检查
-    if (_isnan(current) || !_finite(current)) current = target;
-    if (_isnan(velocity) || !_finite(velocity)) velocity = 0.0f;
+// 打开结果文件：未指定路径时写入临时目录，szPath 返回实际路径
+FILE* OpenBenchOutput(const TCHAR* outPath, const TCHAR* defaultName, TCHAR* szPath, size_t cchPath) {
+    if (outPath && outPath[0]) {
+        _tcscpy_s(szPath, cchPath, outPath);
+    }
+    else {
+        TCHAR szTempPath[MAX_PATH];
+        GetTempPath(MAX_PATH, szTempPath);
+        PathCombine(szPath, szTempPath, defaultName);
+    }
+
+    FILE* fp = NULL;
+    _tfopen_s(&fp, szPath, _T("w, ccs=UTF-8"));
+    return fp;
 }
 
-void UpdatePhysics(float dt) {
-    if (!g.hContainer) return;
+// 置于一次过渡的起点：hide 为 true 时从完全显示开始隐藏，否则反之
+// 与运行时相同经快照交给渲染侧，在本线程中立即取回
+void BenchResetTransition(const ConfigProfile& profile, bool hide) {
+    g.cfg = &profile;
+    g.isHidden = hide;
+    g.startupState = STARTUP_NORMAL;
+    g.targetY = hide ? (float)g.screenH : 0.0f;
+    g.targetAlpha = hide ? 0.0f : 255.0f;
+    g.jumpY = hide ? 0.0f : (float)g.screenH;
+    g.jumpAlpha = hide ? 255.0f : 0.0f;
+    g.jumpSeq++;
+    PublishAnimSnapshot();
+    RenderSync();
+    BankSet(g_Render.bank, LANE_MASK, hide ? (float)g.maxMaskAlpha : 0.0f);
+}
+
+// 无窗口模拟一次过渡，返回到达静止的物理步数
+int BenchTransition(const ConfigProfile& profile, bool hide, BenchLaneStats* stats) {
+    BenchResetTransition(profile, hide);
+    if (stats) {
+        bool motion = (hide ? profile.motionOut : profile.motionIn).enabled;
+        bool opacity = (hide ? profile.opacityOut : profile.opacityIn).enabled;
+        stats[LANE_Y].animated = motion;
+        stats[LANE_ALPHA].animated = opacity;
+        stats[LANE_MASK].animated = motion || opacity; // 蒙版跟随其中有动画的通道
+        for (int i = 0; i < BENCH_LANES; i++) {
+            stats[i].settleTime = 0.0f;
+            stats[i].overshoot = 0.0f;
+            stats[i].renderUpdates = 0;
+            stats[i].lastRender = RenderQuantize(g_Render.bank.pos[i]);
+        }
+    }
 
-    // 状态切换期间加速物理模拟
-    if (g.startupState != STARTUP_NORMAL) dt *= STARTUP_SPEED_FACTOR;
+    float h = ActivePhysicsStep();
+    double t = 0.0;
+    int frame = 0;
+    int step = 0;
+    while (step < BENCH_MAX_STEPS && (step == 0 || !IsPhysicsIdle())) {
+        float before[BANK_LANES];
+        for (int i = 0; i < BANK_LANES; i++) before[i] = g_Render.bank.pos[i];
+        StepPhysics(h);
+        step++;
+        t += h;
+        if (!stats) continue;
+
+        // 按 BENCH_FRAME_DT 划分渲染帧，只在跨越帧边界时采样渲染值
+        bool frameEnd = ((int)(t / BENCH_FRAME_DT) != frame) || IsPhysicsIdle();
+        frame = (int)(t / BENCH_FRAME_DT);
+        for (int i = 0; i < BENCH_LANES; i++) {
+            float pos = g_Render.bank.pos[i];
+            if (pos != before[i]) stats[i].settleTime = (float)t;
+            // 位置通道隐藏时增大，透明度类通道显示时增大，沿运动方向越过目标即为过冲
+            float over = (pos - g_Render.bank.target[i]) * ((hide == (i == LANE_Y)) ? 1.0f : -1.0f);
+            if (over > stats[i].overshoot) stats[i].overshoot = over;
+            if (frameEnd && RenderQuantize(pos) != stats[i].lastRender) {
+                stats[i].renderUpdates++;
+                stats[i].lastRender = RenderQuantize(pos);
+            }
+        }
+    }
+    return step;
+}
 
-    float physicsTargetY = g.targetY;
-    float physicsTargetAlpha = g.targetAlpha;
+// 在虚拟时钟下模拟鼠标静止 BENCH_IDLE_SPAN_MS：与主循环相同的空闲计划、隐藏判断与流水线帧推进，
+// 统计醒来次数与动画帧数。不提交到窗口
+void BenchIdleHour(const ConfigProfile& profile, BenchIdleStats* stats) {
+    UseVirtualClock(true);
+    g.cfg = &profile;
+    g.startupState = STARTUP_NORMAL;
+    g.isHidden = false;
+    g.targetY = 0.0f;
+    g.targetAlpha = 255.0f;
+    g.jumpY = 0.0f;
+    g.jumpAlpha = 255.0f;
+    g.jumpSeq++;
+    PublishAnimSnapshot();
+    RenderSync();
+    BankSet(g_Render.bank, LANE_MASK, (float)g.maxMaskAlpha);
+    g.lastActiveTime = g_Clock->tickMs();
+
+    stats->hideMs = 0.0f;
+    ULONGLONG hideStart = 0;
+    float render[BANK_LANES];
+    while (g_Clock->tickMs() < BENCH_IDLE_SPAN_MS) {
+        bool wasHidden = g.isHidden;
+        UpdateActivity(g_Clock->tickMs(), false);
+        if (g.isHidden && !wasHidden) hideStart = g_Clock->tickMs();
+        PublishAnimSnapshot();
+        RenderSync();
 
-    const SpringParams* pMotion = g.isHidden ? &g.cfg->motionOut : &g.cfg->motionIn;
-    const SpringParams* pOpacity = g.isHidden ? &g.cfg->opacityOut : &g.cfg->opacityIn;
+        if (!IsPhysicsIdle()) {
+            AdvancePhysics(TimerAdvanceTo(PlanFrame()), render);
+            WaitForFrame();
+            if (g.isHidden && IsPhysicsIdle()) stats->hideMs = (float)(g_Clock->tickMs() - hideStart);
+        }
+        else {
+            EndFramePacing();
+            bool wantRawInput = false;
+            DWORD wait = PlanIdleWait(g_Clock->tickMs(), false, &wantRawInput);
+            if (wait == INFINITE) break; // 此后只有用户输入能唤醒
+            WaitForWork(wait);
+            TimerGetDelta(true);
+        }
+    }
+    stats->wakeups = g_VirtualClock.wakeups;
+    stats->frames = g_VirtualClock.vsyncs;
+    UseVirtualClock(false);
+}
 
-    if (pMotion->enabled) SolveSpring(g.currentY, g.velocityY, physicsTargetY, *pMotion, dt);
-    else { g.currentY = physicsTargetY; g.velocityY = 0.0f; } // 禁用时直接到达目标
+// 命令行 /bench [输出文件]：逐个预设测量显示与隐藏过渡，结果以 CSV 输出
+int RunPhysicsBenchmark(const TCHAR* outPath) {
+    TCHAR szPath[MAX_PATH];
+    bool silent = (outPath && outPath[0]);
+    FILE* fp = OpenBenchOutput(outPath, _T("AutoICON_Bench.csv"), szPath, _countof(szPath));
+    if (!fp) return 1;
 
-    if (pOpacity->enabled) SolveSpring(g.currentAlpha, g.velocityAlpha, physicsTargetAlpha, *pOpacity, dt);
-    else { g.currentAlpha = physicsTargetAlpha; g.velocityAlpha = 0.0f; }
+    BenchInit();
 
-    if (g.currentAlpha < 0.0f) g.currentAlpha = 0.0f;
-    if (g.currentAlpha > 255.0f) g.currentAlpha = 255.0f;
+    LARGE_INTEGER freq, t0, t1;
+    QueryPerformanceFrequency(&freq);
 
-    int renderY = (int)g.currentY;
-    int renderAlpha = (int)g.currentAlpha;
+    const TCHAR* laneNames[BENCH_LANES] = { _T("motion"), _T("opacity"), _T("mask") };
+    _ftprintf(fp, _T("profile,name,direction,channel,ns_per_step,steps_to_idle,settle_ms,overshoot,render_updates,idle_wakeups_per_hour,idle_frames_per_hour,hide_ms\n"));
 
-    // 仅在值发生变化时调用 WinAPI，减少开销
-    if (renderY != g.lastRenderY) {
-        SetWindowPos(g.hContainer, NULL, 0, renderY, 0, 0, SWP_NOSIZE | SWP_NOZORDER | SWP_NOACTIVATE);
-        if (g.hMaskWindow && IsWindow(g.hMaskWindow) && IsWindowVisible(g.hMaskWindow)) {
-            int extendedH = (int)(g.screenH * 1.04f);
-            int offsetY = (int)(g.screenH * 0.02f);
-            SetWindowPos(g.hMaskWindow, NULL, 0, renderY - offsetY, g.screenW, extendedH, SWP_NOZORDER | SWP_NOACTIVATE);
+    for (int i = 0; i < PRESET_COUNT; i++) {
+        BenchIdleStats idle;
+        BenchIdleHour(PRESETS[i], &idle);
+
+        for (int dir = 0; dir < 2; dir++) {
+            bool hide = (dir == 1);
+
+            // 重复多次取平均，摊薄计时开销
+            int totalSteps = 0;
+            QueryPerformanceCounter(&t0);
+            for (int r = 0; r < BENCH_REPEAT; r++) totalSteps += BenchTransition(PRESETS[i], hide, NULL);
+            QueryPerformanceCounter(&t1);
+            double nsPerStep = (double)(t1.QuadPart - t0.QuadPart) * 1e9 / (double)freq.QuadPart / (totalSteps > 0 ? totalSteps : 1);
+
+            BenchLaneStats stats[BENCH_LANES];
+            int steps = BenchTransition(PRESETS[i], hide, stats);
+
+            for (int k = 0; k < BENCH_LANES; k++) {
+                // 没有动画的通道只是跳到目标，轨迹各列记为 -
+                TCHAR settle[16] = _T("-"), overshoot[16] = _T("-"), updates[16] = _T("-");
+                if (stats[k].animated) {
+                    _stprintf_s(settle, _countof(settle), _T("%.1f"), stats[k].settleTime * 1000.0f);
+                    _stprintf_s(overshoot, _countof(overshoot), _T("%.2f"), stats[k].overshoot);
+                    _stprintf_s(updates, _countof(updates), _T("%d"), stats[k].renderUpdates);
+                }
+                _ftprintf(fp, _T("%d,%s,%s,%s,%.1f,%d,%s,%s,%s,%d,%d,%.1f\n"),
+                    i, PRESETS[i].name, hide ? _T("out") : _T("in"), laneNames[k],
+                    nsPerStep, steps, settle, overshoot, updates,
+                    idle.wakeups, idle.frames, idle.hideMs);
+            }
         }
-        g.lastRenderY = renderY;
     }
+    fclose(fp);
 
-    if (renderAlpha != g.lastRenderAlpha) {
-        SetLayeredWindowAttributes(g.hContainer, 0, (BYTE)renderAlpha, LWA_ALPHA);
-        g.lastRenderAlpha = renderAlpha;
+    if (!silent) {
+        TCHAR msg[MAX_PATH + 64];
+        _stprintf_s(msg, _countof(msg), _T("基准测试完成，结果已保存至：\n%s"), szPath);
+        MessageBox(NULL, msg, APP_NAME, MB_OK | MB_ICONINFORMATION);
     }
+    return 0;
+}
 
-    // 蒙版透明度联动
-    if (g.hMaskWindow && IsWindow(g.hMaskWindow) && IsWindowVisible(g.hMaskWindow) && g.maxMaskAlpha > 0) {
-        int maskCurrentAlpha = 0;
-        if (pOpacity->enabled) {
-            float ratio = g.currentAlpha / 255.0f;
-            maskCurrentAlpha = (int)(g.maxMaskAlpha * ratio);
-        }
+// 以模拟显示器运行一次过渡动画，经过与主循环相同的帧调度
+void PacingTransition(const ConfigProfile& profile, bool hide, int refreshHz, bool fixedRate, PacingStats* stats) {
+    UseVirtualClock(true);
+    g_VirtualClock.vblankUs = 1000000 / refreshHz;
+    g_Render.pacer.fixedRate = fixedRate;
+    BenchResetTransition(profile, hide);
+
+    float render[BANK_LANES];
+    int last[BENCH_LANES];
+    for (int i = 0; i < BENCH_LANES; i++) last[i] = RenderQuantize(g_Render.bank.pos[i]);
+    LONGLONG first = 0, prev = 0;
+    stats->frames = 0;
+    stats->coarseSteps = 0;
+    stats->minGapMs = stats->maxGapMs = 0.0f;
+    while (!IsPhysicsIdle() && stats->frames < BENCH_MAX_STEPS) {
+        AdvancePhysics(TimerAdvanceTo(PlanFrame()), render);
+        WaitForFrame();
+        LONGLONG now = g_Clock->counter();
+        if (stats->frames == 0) first = now;
         else {
-            float hiddenRatio = g.currentY / (float)g.screenH;
-            float opacityRatio = 1.0f - hiddenRatio;
-            if (opacityRatio < 0.0f) opacityRatio = 0.0f;
-            maskCurrentAlpha = (int)(g.maxMaskAlpha * opacityRatio);
+            float gap = (now - prev) / 1000.0f;
+            if (stats->frames == 1 || gap < stats->minGapMs) stats->minGapMs = gap;
+            if (gap > stats->maxGapMs) stats->maxGapMs = gap;
         }
-        if (maskCurrentAlpha != g.lastMaskAlpha) {
-            SetLayeredWindowAttributes(g.hMaskWindow, 0, (BYTE)maskCurrentAlpha, LWA_ALPHA);
-            g.lastMaskAlpha = maskCurrentAlpha;
+        prev = now;
+        stats->frames++;
+
+        bool coarse = false;
+        for (int i = 0; i < BENCH_LANES; i++) {
+            int q = RenderQuantize(render[i]);
+            if (abs(q - last[i]) > 1) coarse = true;
+            last[i] = q;
         }
+        if (coarse) stats->coarseSteps++;
     }
+    EndFramePacing();
 
-    // 周期性维护 Z-Order，防止被其他全屏应用覆盖
-    g.zOrderGuardCounter++;
-    if (g.zOrderGuardCounter > 30) {
-        EnforceZOrder();
-        g.zOrderGuardCounter = 0;
+    stats->avgFps = (stats->frames > 1) ? (float)((stats->frames - 1) * 1e6 / (double)(prev - first)) : 0.0f;
+    stats->wakeups = g_VirtualClock.wakeups;
+    g_Render.pacer.fixedRate = false;
+    UseVirtualClock(false);
+}
+
+// 命令行 /pacing：以 PACING_REFRESH_HZ 中的刷新率模拟显示器，逐个预设、方向与帧率上限运行过渡动画，
+// 对比关闭与开启尾段降频时的帧数，以及单帧量化值变化超过 1 的次数 (可见的跳变)
+int RunPacingSimulation(const TCHAR* outPath) {
+    TCHAR szPath[MAX_PATH];
+    bool silent = (outPath && outPath[0]);
+    FILE* fp = OpenBenchOutput(outPath, _T("AutoICON_Pacing.csv"), szPath, _countof(szPath));
+    if (!fp) return 1;
+
+    BenchInit();
+    _ftprintf(fp, _T("profile,name,direction,refresh_hz,cap_fps,frames_fixed,frames,avg_fps,min_interval_ms,max_interval_ms,timer_wakeups,coarse_steps_fixed,coarse_steps\n"));
+
+    int savedCap = g.frameCapIndex;
+    for (int i = 0; i < PRESET_COUNT; i++) {
+        for (int dir = 0; dir < 2; dir++) {
+            bool hide = (dir == 1);
+            for (int r = 0; r < PACING_REFRESH_COUNT; r++) {
+                for (int c = 0; c < FRAME_CAP_COUNT; c++) {
+                    g.frameCapIndex = c;
+                    PacingStats fixed, adaptive;
+                    PacingTransition(PRESETS[i], hide, PACING_REFRESH_HZ[r], true, &fixed);
+                    PacingTransition(PRESETS[i], hide, PACING_REFRESH_HZ[r], false, &adaptive);
+                    _ftprintf(fp, _T("%d,%s,%s,%d,%d,%d,%d,%.1f,%.2f,%.2f,%d,%d,%d\n"),
+                        i, PRESETS[i].name, hide ? _T("out") : _T("in"), PACING_REFRESH_HZ[r], FRAME_CAP_OPTIONS[c],
+                        fixed.frames, adaptive.frames, adaptive.avgFps, adaptive.minGapMs, adaptive.maxGapMs,
+                        adaptive.wakeups, fixed.coarseSteps, adaptive.coarseSteps);
+                }
+            }
+        }
+    }
+    g.frameCapIndex = savedCap;
+    fclose(fp);
+
+    if (!silent) {
+        TCHAR msg[MAX_PATH + 64];
+        _stprintf_s(msg, _countof(msg), _T("帧调度模拟完成，结果已保存至：\n%s"), szPath);
+        MessageBox(NULL, msg, APP_NAME, MB_OK | MB_ICONINFORMATION);
     }
+    return 0;
 }
 
-bool IsPhysicsIdle() {
-    const SpringParams* pMotion = g.isHidden ? &g.cfg->motionOut : &g.cfg->motionIn;
-    const SpringParams* pOpacity = g.isHidden ? &g.cfg->opacityOut : &g.cfg->opacityIn;
+// 为单个通道搜索弹簧参数：静止时刻落在 [TUNE_MIN_DURATION × 时长, 时长] 内且过冲不超限的候选中，
+// 取到达渲染静止帧数最少者，帧数相同时取渲染更新次数最少者
+bool TuneChannel(int lane, float durationMs, float overshootPct, TuneResult& best) {
+    ConfigProfile profile = { _T("tune"), 0, 0, SP_OFF, SP_OFF, SP_OFF, SP_OFF };
+    float travel = (lane == LANE_Y) ? (float)g.screenH : 255.0f;
+    bool found = false;
 
-    bool yIdle = true;
-    bool alphaIdle = true;
+    for (int i = 0; i < TUNE_TENSION_STEPS; i++) {
+        double tension = TUNE_TENSION_MIN * pow(TUNE_TENSION_MAX / TUNE_TENSION_MIN, (double)i / (TUNE_TENSION_STEPS - 1));
+        for (int j = 0; j < TUNE_ZETA_STEPS; j++) {
+            double zeta = TUNE_ZETA_MIN + (TUNE_ZETA_MAX - TUNE_ZETA_MIN) * j / (TUNE_ZETA_STEPS - 1);
+            SpringParams p = MakeSpring((float)tension, (float)(2.0 * zeta * sqrt(tension)));
+            if (lane == LANE_Y) profile.motionIn = profile.motionOut = p;
+            else profile.opacityIn = profile.opacityOut = p;
+
+            // 候选曲线临时登记在曲线表末尾，评估完即撤销
+            BakeSpringCurve(g_Curves[g_CurveCount++], p);
+            BenchLaneStats stats[BENCH_LANES];
+            BenchTransition(profile, true, stats);
+            g_CurveCount--;
+
+            TuneResult r;
+            r.spring = p;
+            r.settleMs = stats[lane].settleTime * 1000.0f;
+            r.overshootPct = stats[lane].overshoot * 100.0f / travel;
+            r.frames = (int)ceilf(stats[lane].settleTime / BENCH_FRAME_DT);
+            r.renderUpdates = stats[lane].renderUpdates;
+            if (r.settleMs > durationMs || r.settleMs < durationMs * TUNE_MIN_DURATION || r.overshootPct > overshootPct) continue;
+            if (!found || r.frames < best.frames || (r.frames == best.frames && r.renderUpdates < best.renderUpdates)) {
+                best = r;
+                found = true;
+            }
+        }
+    }
+    return found;
+}
 
-    if (pMotion->enabled) {
-        double dy = fabs(g.targetY - g.currentY);
-        yIdle = (dy < 1.0f && fabs(g.velocityY) < 2.0f);
+// 命令行 /tune：为位置与透明度通道各搜索一组参数，输出可直接粘贴的 SpringParams 定义
+int RunSpringTuner(float durationMs, float overshootPct, const TCHAR* outPath) {
+    TCHAR szPath[MAX_PATH];
+    bool silent = (outPath && outPath[0]);
+    FILE* fp = OpenBenchOutput(outPath, _T("AutoICON_Tune.txt"), szPath, _countof(szPath));
+    if (!fp) return 1;
+
+    BenchInit();
+
+    const int lanes[2] = { LANE_Y, LANE_ALPHA };
+    const TCHAR* laneNames[2] = { _T("位置"), _T("透明度") };
+    const TCHAR* defNames[2] = { _T("SP_TUNED_MOTION"), _T("SP_TUNED_OPACITY") };
+    _ftprintf(fp, _T("// /tune 时长 %.0f ms，过冲 <= %.1f%%，%d Hz 渲染\n"), durationMs, overshootPct, (int)(1.0f / BENCH_FRAME_DT + 0.5f));
+
+    for (int k = 0; k < 2; k++) {
+        TuneResult r;
+        if (!TuneChannel(lanes[k], durationMs, overshootPct, r)) {
+            _ftprintf(fp, _T("// %s通道：给定时长与过冲范围内没有可行参数\n"), laneNames[k]);
+            continue;
+        }
+        _ftprintf(fp, _T("// %s通道：静止 %.1f ms，过冲 %.2f%%，%d 帧，%d 次渲染更新\n"),
+            laneNames[k], r.settleMs, r.overshootPct, r.frames, r.renderUpdates);
+        _ftprintf(fp, _T("const SpringParams %s = MakeSpring(%.1ff, %.1ff);\n"), defNames[k], r.spring.tension, r.spring.friction);
     }
-    if (pOpacity->enabled) {
-        double da = fabs(g.targetAlpha - g.currentAlpha);
-        alphaIdle = (da < 1.0f && fabs(g.velocityAlpha) < 2.0f);
+    fclose(fp);
+
+    if (!silent) {
+        TCHAR msg[MAX_PATH + 64];
+        _stprintf_s(msg, _countof(msg), _T("参数搜索完成，结果已保存至：\n%s"), szPath);
+        MessageBox(NULL, msg, APP_NAME, MB_OK | MB_ICONINFORMATION);
     }
-    return yIdle && alphaIdle;
+    return 0;
 }
 
 // --- 窗口管理实现 ---
 
 BOOL CALLBACK FindSysListViewProc(HWND hwnd, LPARAM lParam) {
     // 寻找包含 ShellDLL_DefView 的 WorkerW 或 Progman
+    PerfCount(PC_FINDWINDOW);
     HWND hShellView = FindWindowEx(hwnd, NULL, _T("SHELLDLL_DefView"), NULL);
     if (hShellView) {
         g.hContainer = hShellView;
@@ -845,11 +3169,15 @@ void EnableLayeredStyle(HWND hwnd, bool enable) {
     }
 }
 
-void EnforceZOrder() {
-    if (!g.hContainer || !IsWindow(g.hContainer)) return;
-    SetWindowPos(g.hContainer, HWND_TOP, 0, 0, 0, 0, SWP_NOMOVE | SWP_NOSIZE | SWP_NOACTIVATE);
-    if (g.hMaskWindow && IsWindow(g.hMaskWindow)) {
-        SetWindowPos(g.hMaskWindow, g.hContainer, 0, 0, 0, 0, SWP_NOMOVE | SWP_NOSIZE | SWP_NOACTIVATE);
+// 逻辑线程与渲染线程都会调用，窗口句柄由调用方给出
+void EnforceZOrder(HWND hContainer, HWND hMask) {
+    if (!hContainer || !IsWindow(hContainer)) return;
+    PerfCount(PC_ENFORCEZORDER);
+    PerfCount(PC_SETWINDOWPOS);
+    SetWindowPos(hContainer, HWND_TOP, 0, 0, 0, 0, SWP_NOMOVE | SWP_NOSIZE | SWP_NOACTIVATE);
+    if (hMask && IsWindow(hMask)) {
+        PerfCount(PC_SETWINDOWPOS);
+        SetWindowPos(hMask, hContainer, 0, 0, 0, 0, SWP_NOMOVE | SWP_NOSIZE | SWP_NOACTIVATE);
     }
 }
 
@@ -867,6 +3195,16 @@ void CreateMaskWindow(HINSTANCE hInstance) {
         wc.lpszClassName, NULL, WS_POPUP, 0, 0, 0, 0, NULL, NULL, hInstance, NULL);
 }
 
+// 销毁遮罩窗口。先发布不含该句柄的快照并等渲染线程取走，避免它对已销毁 (或被复用) 的句柄操作
+void DestroyMaskWindow() {
+    HWND hMask = g.hMaskWindow;
+    if (!hMask) return;
+    g.hMaskWindow = NULL;
+    PublishAnimSnapshot();
+    WaitRenderSnapshotConsumed();
+    if (IsWindow(hMask)) DestroyWindow(hMask);
+}
+
 void AttachMaskToDesktop() {
     if (!g.hMaskWindow || !IsWindow(g.hMaskWindow)) return;
     if (!g.hContainer || !IsWindow(g.hContainer)) return;
@@ -880,8 +3218,10 @@ void AttachMaskToDesktop() {
     int extendedH = (int)(g.screenH * 1.04f);
     int offsetY = (int)(g.screenH * 0.02f);
 
+    PerfCount(PC_SETWINDOWPOS);
     SetWindowPos(g.hMaskWindow, NULL, 0, -offsetY, g.screenW, extendedH, SWP_NOZORDER | SWP_NOACTIVATE | SWP_FRAMECHANGED);
-    EnforceZOrder();
+    EnforceZOrder(g.hContainer, g.hMaskWindow);
+    PerfCount(PC_SETLAYERED);
     SetLayeredWindowAttributes(g.hMaskWindow, 0, 0, LWA_ALPHA);
     ShowWindow(g.hMaskWindow, SW_SHOWNA);
 }
@@ -890,6 +3230,7 @@ void LocateDesktop(HINSTANCE hInstance) {
     g.hContainer = NULL;
     g.hDesktopParent = NULL;
 
+    PerfCount(PC_FINDWINDOW);
     HWND hProgman = FindWindow(_T("Progman"), NULL);
     FindSysListViewProc(hProgman, 0);
     if (!g.hContainer) EnumWindows(FindSysListViewProc, 0);
@@ -910,10 +3251,12 @@ void LocateDesktop(HINSTANCE hInstance) {
         g.targetY = (float)g.screenH;
         g.targetAlpha = 0.0f;
         g.startupState = STARTUP_PHASE_1_HIDING;
-        g.startupPhaseStartTime = GetTickCount64();
+        g.startupPhaseStartTime = g_Clock->tickMs();
 
+        PerfCount(PC_SETWINDOWPOS);
         SetWindowPos(g.hContainer, NULL, 0, 0, 0, 0, SWP_NOSIZE | SWP_NOZORDER | SWP_NOACTIVATE | SWP_FRAMECHANGED);
         EnableLayeredStyle(g.hContainer, true);
+        PerfCount(PC_SETLAYERED);
         SetLayeredWindowAttributes(g.hContainer, 0, 255, LWA_ALPHA);
 
         if (g.hMaskWindow && IsWindow(g.hMaskWindow)) {
@@ -934,6 +3277,61 @@ void InitTrayIcon(HWND hwnd) {
     Shell_NotifyIcon(NIM_ADD, &nid);
 }
 
+// 悬停托盘图标时在提示中显示每分钟的平均计数，最多每秒刷新一次
+void UpdateTrayTooltip() {
+    static ULONGLONG lastUpdate = 0;
+    ULONGLONG now = g_Clock->tickMs();
+    if (now - lastUpdate < 1000) return;
+    lastUpdate = now;
+
+    LONGLONG totals[PC_COUNT];
+    PerfCollect(totals);
+    double minutes = (now - g_PerfStartTick) / 60000.0;
+    if (minutes < 1.0 / 60.0) minutes = 1.0 / 60.0;
+
+    _stprintf_s(nid.szTip, _countof(nid.szTip), _T("%s\n每分钟 (所有线程合计)：唤醒 %.1f，帧 %.1f\n窗口调用 %.1f，命中测试 %.1f"),
+        APP_NAME, totals[PC_WAKEUP] / minutes, totals[PC_DWMFLUSH] / minutes,
+        (totals[PC_SETWINDOWPOS] + totals[PC_SETLAYERED]) / minutes, totals[PC_WINDOWFROMPOINT] / minutes);
+    NOTIFYICONDATA tip = nid;
+    tip.uFlags = NIF_TIP;
+    Shell_NotifyIcon(NIM_MODIFY, &tip);
+}
+
+// 托盘菜单“导出性能计数”：写出各计数的总数与每分钟平均值，其后按线程分列。
+// 超出 PERF_MAX_THREADS 的线程与最后一个线程共用一列，列名注明共用的线程数
+int ExportPerfCounters() {
+    TCHAR szPath[MAX_PATH];
+    FILE* fp = OpenBenchOutput(NULL, _T("AutoICON_Counters.csv"), szPath, _countof(szPath));
+    if (!fp) return 1;
+
+    LONGLONG totals[PC_COUNT];
+    PerfCollect(totals);
+    double minutes = (g_Clock->tickMs() - g_PerfStartTick) / 60000.0;
+    if (minutes < 1.0 / 60.0) minutes = 1.0 / 60.0;
+
+    LONG threads = g_PerfBlockCount.load();
+    LONG blocks = (threads > PERF_MAX_THREADS) ? PERF_MAX_THREADS : threads;
+    _ftprintf(fp, _T("counter,total,per_minute"));
+    for (int i = 0; i < blocks; i++) {
+        const TCHAR* name = g_PerfBlocks[i].thread.load(std::memory_order_relaxed);
+        if (i == PERF_MAX_THREADS - 1 && threads > PERF_MAX_THREADS) _ftprintf(fp, _T(",shared_%ld_threads"), threads - PERF_MAX_THREADS + 1);
+        else if (name) _ftprintf(fp, _T(",%s"), name);
+        else _ftprintf(fp, _T(",thread_%d"), i);
+    }
+    _ftprintf(fp, _T("\n"));
+    for (int id = 0; id < PC_COUNT; id++) {
+        _ftprintf(fp, _T("%s,%lld,%.2f"), PERF_COUNTER_NAMES[id], totals[id], totals[id] / minutes);
+        for (int i = 0; i < blocks; i++) _ftprintf(fp, _T(",%ld"), g_PerfBlocks[i].counts[id].load(std::memory_order_relaxed));
+        _ftprintf(fp, _T("\n"));
+    }
+    fclose(fp);
+
+    TCHAR msg[MAX_PATH + 64];
+    _stprintf_s(msg, _countof(msg), _T("性能计数已保存至：\n%s"), szPath);
+    MessageBox(NULL, msg, APP_NAME, MB_OK | MB_ICONINFORMATION);
+    return 0;
+}
+
 void CreateMessageWindow(HINSTANCE hInstance) {
     WNDCLASSEX wc = { 0 };
     wc.cbSize = sizeof(WNDCLASSEX);
@@ -949,11 +3347,13 @@ void CreateMessageWindow(HINSTANCE hInstance) {
 bool IsMouseOnDesktop() {
     POINT pt;
     GetCursorPos(&pt);
+    PerfCount(PC_WINDOWFROMPOINT);
     HWND hWin = WindowFromPoint(pt);
     if (!hWin) return false;
     // 如果鼠标悬停在蒙版、容器或桌面父窗口上，视为在桌面
     if (hWin == g.hMaskWindow) return true;
     if (hWin == g.hContainer || hWin == g.hDesktopParent) return true;
+    PerfCount(PC_FINDWINDOW);
     if (hWin == FindWindow(_T("Progman"), NULL)) return true;
     // 检查父窗口（针对ListView内的图标）
     HWND hParent = GetParent(hWin);
@@ -1058,7 +3458,7 @@ bool WaitForProcessExit(const TCHAR* processName, DWORD timeoutMs) {
 }
 
 bool IsInstalled() {
-    return GetFileAttributes(g.szInstallExePath) != INVALID_FILE_ATTRIBUTES;
+    return GetFileAttributes(g_Paths.szInstallExePath) != INVALID_FILE_ATTRIBUTES;
 }
 
 bool GetInstalledVersion(TCHAR* version, size_t size) {
@@ -1076,7 +3476,7 @@ bool CopyToInstallDirWithRetry() {
     TCHAR currentPath[MAX_PATH];
     GetModuleFileName(NULL, currentPath, MAX_PATH);
 
-    if (!CreateDirectory(g.szInstallDir, NULL) && GetLastError() != ERROR_ALREADY_EXISTS) {
+    if (!CreateDirectory(g_Paths.szInstallDir, NULL) && GetLastError() != ERROR_ALREADY_EXISTS) {
         DWORD err = GetLastError();
         TCHAR msg[256];
         _stprintf_s(msg, _countof(msg), _T("无法创建安装目录！\n错误代码: %d"), err);
@@ -1084,7 +3484,7 @@ bool CopyToInstallDirWithRetry() {
         return false;
     }
 
-    if (GetFileAttributes(g.szInstallExePath) != INVALID_FILE_ATTRIBUTES) {
+    if (GetFileAttributes(g_Paths.szInstallExePath) != INVALID_FILE_ATTRIBUTES) {
         KillRunningProcesses();
         if (!WaitForProcessExit(EXE_NAME, 3000)) {
             MessageBox(NULL, _T("无法关闭正在运行的程序！\n请手动关闭后再试。"), APP_NAME, MB_OK | MB_ICONWARNING);
@@ -1095,7 +3495,7 @@ bool CopyToInstallDirWithRetry() {
 
     bool copySuccess = false;
     for (int i = 0; i < 5; i++) {
-        if (CopyFile(currentPath, g.szInstallExePath, FALSE)) {
+        if (CopyFile(currentPath, g_Paths.szInstallExePath, FALSE)) {
             copySuccess = true;
             break;
         }
@@ -1116,13 +3516,13 @@ void RegisterUninstallInfo() {
     HKEY hKey;
     if (RegCreateKeyEx(HKEY_LOCAL_MACHINE, REG_UNINSTALL_KEY, 0, NULL, 0, KEY_WRITE, NULL, &hKey, NULL) == ERROR_SUCCESS) {
         TCHAR uninstallCmd[MAX_PATH];
-        _stprintf_s(uninstallCmd, _countof(uninstallCmd), _T("\"%s\" /uninstall"), g.szInstallExePath);
+        _stprintf_s(uninstallCmd, _countof(uninstallCmd), _T("\"%s\" /uninstall"), g_Paths.szInstallExePath);
 
         RegSetValueEx(hKey, _T("DisplayName"), 0, REG_SZ, (BYTE*)APP_NAME, (DWORD)(_tcslen(APP_NAME) + 1) * sizeof(TCHAR));
         RegSetValueEx(hKey, _T("DisplayVersion"), 0, REG_SZ, (BYTE*)APP_VERSION_STR, (DWORD)(_tcslen(APP_VERSION_STR) + 1) * sizeof(TCHAR));
         RegSetValueEx(hKey, _T("Publisher"), 0, REG_SZ, (BYTE*)APP_NAME, (DWORD)(_tcslen(APP_NAME) + 1) * sizeof(TCHAR));
         RegSetValueEx(hKey, _T("UninstallString"), 0, REG_SZ, (BYTE*)uninstallCmd, (DWORD)(_tcslen(uninstallCmd) + 1) * sizeof(TCHAR));
-        RegSetValueEx(hKey, _T("InstallLocation"), 0, REG_SZ, (BYTE*)g.szInstallDir, (DWORD)(_tcslen(g.szInstallDir) + 1) * sizeof(TCHAR));
+        RegSetValueEx(hKey, _T("InstallLocation"), 0, REG_SZ, (BYTE*)g_Paths.szInstallDir, (DWORD)(_tcslen(g_Paths.szInstallDir) + 1) * sizeof(TCHAR));
 
         DWORD dwordVal = 1;
         RegSetValueEx(hKey, _T("NoModify"), 0, REG_DWORD, (BYTE*)&dwordVal, sizeof(DWORD));
@@ -1154,7 +3554,7 @@ void SetAutoStart(bool enabled) {
         if (enabled) {
             // 包裹引号以处理路径空格
             TCHAR cmd[MAX_PATH];
-            _stprintf_s(cmd, _countof(cmd), _T("\"%s\""), g.szInstallExePath);
+            _stprintf_s(cmd, _countof(cmd), _T("\"%s\""), g_Paths.szInstallExePath);
             RegSetValueEx(hKey, APP_NAME, 0, REG_SZ, (BYTE*)cmd, (DWORD)(_tcslen(cmd) + 1) * sizeof(TCHAR));
         }
         else {
@@ -1165,16 +3565,20 @@ void SetAutoStart(bool enabled) {
 }
 
 void RunInstalledExe() {
-    ShellExecute(NULL, _T("open"), g.szInstallExePath, NULL, NULL, SW_SHOWDEFAULT);
+    ShellExecute(NULL, _T("open"), g_Paths.szInstallExePath, NULL, NULL, SW_SHOWDEFAULT);
 }
 
 void PerformExitSequence() {
-    if (g.hMaskWindow && IsWindow(g.hMaskWindow)) DestroyWindow(g.hMaskWindow);
+    DestroyMaskWindow();
     Shell_NotifyIcon(NIM_DELETE, &nid);
     DWORD pid = 0;
     // 尝试寻找任务栏或 Progman 刷新界面
+    PerfCount(PC_FINDWINDOW);
     HWND hShellWnd = FindWindow(_T("Shell_TrayWnd"), NULL);
-    if (!hShellWnd) hShellWnd = FindWindow(_T("Progman"), NULL);
+    if (!hShellWnd) {
+        PerfCount(PC_FINDWINDOW);
+        hShellWnd = FindWindow(_T("Progman"), NULL);
+    }
     if (hShellWnd) {
         GetWindowThreadProcessId(hShellWnd, &pid);
         // 这里原逻辑是终止 Explorer？这非常危险且不推荐。
@@ -1199,7 +3603,7 @@ void HandleInstallation() {
     GetModuleFileName(NULL, currentPath, MAX_PATH);
 
     // 如果已经在安装目录运行，直接返回
-    if (_tcsnicmp(currentPath, g.szInstallDir, _tcslen(g.szInstallDir)) == 0) return;
+    if (_tcsnicmp(currentPath, g_Paths.szInstallDir, _tcslen(g_Paths.szInstallDir)) == 0) return;
 
     if (!IsRunAsAdministrator()) {
         int result = MessageBox(NULL, _T("AutoICON 需要管理员权限才能执行安装或更新操作。\n是否允许提权？"), APP_NAME, MB_YESNO | MB_ICONQUESTION);
@@ -1225,7 +3629,7 @@ void HandleInstallation() {
 
     if (!bFileExists) {
         TCHAR msg[512];
-        _stprintf_s(msg, _countof(msg), _T("欢迎使用 AutoICON！\n\n即将安装版本: %s\n安装位置: %s\n\n是否继续？"), APP_VERSION_STR, g.szInstallDir);
+        _stprintf_s(msg, _countof(msg), _T("欢迎使用 AutoICON！\n\n即将安装版本: %s\n安装位置: %s\n\n是否继续？"), APP_VERSION_STR, g_Paths.szInstallDir);
         if (MessageBox(NULL, msg, APP_NAME, MB_YESNO | MB_ICONQUESTION) == IDYES) {
             HWND hWaitWnd = CreateWindow(_T("STATIC"), _T("正在安装..."), WS_POPUP | WS_VISIBLE, 300, 300, 300, 60, NULL, NULL, NULL, NULL);
             if (CopyToInstallDirWithRetry()) {
@@ -1286,7 +3690,7 @@ void HandleInstallation() {
 void HandleUninstall() {
     if (!IsRunAsAdministrator()) { MessageBox(NULL, _T("卸载程序需要管理员权限！"), APP_NAME, MB_OK | MB_ICONERROR); return; }
     TCHAR currentPath[MAX_PATH]; GetModuleFileName(NULL, currentPath, MAX_PATH);
-    if (_tcsnicmp(currentPath, g.szInstallDir, _tcslen(g.szInstallDir)) != 0) {
+    if (_tcsnicmp(currentPath, g_Paths.szInstallDir, _tcslen(g_Paths.szInstallDir)) != 0) {
         MessageBox(NULL, _T("请从安装目录运行卸载程序。"), APP_NAME, MB_OK | MB_ICONERROR); return;
     }
     if (MessageBox(NULL, _T("确定要卸载 AutoICON 吗？"), APP_NAME, MB_YESNO | MB_ICONQUESTION) != IDYES) return;
@@ -1303,7 +3707,7 @@ void HandleUninstall() {
     _tfopen_s(&fp, szBatPath, _T("w"));
     if (fp) {
         // 创建自删除批处理脚本
-        _ftprintf(fp, _T("@echo off\n:LOOP\ntimeout /t 1 /nobreak > nul\ndel /F /Q \"%s\"\nif exist \"%s\" goto LOOP\nrmdir /S /Q \"%s\"\ndel \"%%~f0\"\n"), currentPath, currentPath, g.szInstallDir);
+        _ftprintf(fp, _T("@echo off\n:LOOP\ntimeout /t 1 /nobreak > nul\ndel /F /Q \"%s\"\nif exist \"%s\" goto LOOP\nrmdir /S /Q \"%s\"\ndel \"%%~f0\"\n"), currentPath, currentPath, g_Paths.szInstallDir);
         fclose(fp);
     }
     ShellExecute(NULL, _T("open"), szBatPath, NULL, NULL, SW_HIDE);
@@ -1315,36 +3719,131 @@ void SaveSettings() {
     if (RegCreateKeyEx(HKEY_CURRENT_USER, REG_SUBKEY, 0, NULL, 0, KEY_WRITE, NULL, &hKey, NULL) == ERROR_SUCCESS) {
         RegSetValueEx(hKey, REG_VAL_PROFILE, 0, REG_DWORD, (BYTE*)&g.cfgIndex, sizeof(g.cfgIndex));
         RegSetValueEx(hKey, REG_VAL_MASK, 0, REG_DWORD, (BYTE*)&g.maskOptIndex, sizeof(g.maskOptIndex));
+        RegSetValueEx(hKey, REG_VAL_FRAMECAP, 0, REG_DWORD, (BYTE*)&g.frameCapIndex, sizeof(g.frameCapIndex));
         RegCloseKey(hKey);
     }
 }
 
 void LoadSettings() {
-    HKEY hKey; g.cfgIndex = 0; g.maskOptIndex = 0;
+    HKEY hKey; g.cfgIndex = 0; g.maskOptIndex = 0; g.frameCapIndex = 0;
     if (RegOpenKeyEx(HKEY_CURRENT_USER, REG_SUBKEY, 0, KEY_READ, &hKey) == ERROR_SUCCESS) {
         DWORD size = sizeof(DWORD);
         RegQueryValueEx(hKey, REG_VAL_PROFILE, NULL, NULL, (BYTE*)&g.cfgIndex, &size);
         size = sizeof(DWORD);
         RegQueryValueEx(hKey, REG_VAL_MASK, NULL, NULL, (BYTE*)&g.maskOptIndex, &size);
+        size = sizeof(DWORD);
+        RegQueryValueEx(hKey, REG_VAL_FRAMECAP, NULL, NULL, (BYTE*)&g.frameCapIndex, &size);
         RegCloseKey(hKey);
     }
     if (g.cfgIndex < 0 || g.cfgIndex >= PRESET_COUNT) g.cfgIndex = 0;
     if (g.maskOptIndex < 0 || g.maskOptIndex >= MASK_OPT_COUNT) g.maskOptIndex = 0;
+    if (g.frameCapIndex < 0 || g.frameCapIndex >= FRAME_CAP_COUNT) g.frameCapIndex = 0;
     g.cfg = &PRESETS[g.cfgIndex]; g.maxMaskAlpha = MASK_OPTIONS[g.maskOptIndex].alpha;
 }
 
+// 逻辑线程的一次推进：启动/切换动画的状态机，进入正常运行阶段后交给 UpdateActivity。
+// 只修改 g 中的目标与请求序号，由调用方随后发布快照
+void LogicTick(HINSTANCE hInstance, ULONGLONG now, bool isMoving) {
+    if (g.startupState == STARTUP_PHASE_1_HIDING) { // 0: 启动时的隐藏阶段
+        // 渲染线程尚未应用隐藏目标时，状态中的位置还属于之前的快照
+        const RenderStatus& rs = LatestRenderStatus();
+        bool hiddenEnough = (rs.seq == g.published.seq);
+        if (rs.y < g.screenH * 0.9f && rs.alpha > 10.0f) hiddenEnough = false;
+        if (hiddenEnough || (now - g.startupPhaseStartTime > 2000)) {
+            g.startupState = STARTUP_PHASE_2_WAITING;
+            g.waitStartTime = now;
+        }
+    }
+    else if (g.startupState == STARTUP_PHASE_2_WAITING) { // 1: 等待配置切换
+        if (now - g.waitStartTime > STARTUP_TRANSITION_DELAY) {
+            // 应用新配置。重新定位桌面时遮罩已被隐藏，挂到新的桌面父窗口下
+            ApplySettings(hInstance, true);
+
+            // 重置位置准备进入
+            g.targetY = 0.0f;
+            g.targetAlpha = 255.0f;
+            g.jumpY = g.cfg->motionIn.enabled ? (float)g.screenH : 0.0f;
+            g.jumpAlpha = g.cfg->opacityIn.enabled ? 0.0f : 255.0f;
+            g.jumpSeq++;
+
+            g.startupState = STARTUP_PHASE_3_SHOWING;
+            g.isHidden = false;
+            g.lastActiveTime = now;
+            EnforceZOrder(g.hContainer, g.hMaskWindow);
+        }
+    }
+    else if (g.startupState == STARTUP_PHASE_3_SHOWING) { // 2: 显示阶段
+        if (RenderIdle() || (isMoving && IsMouseOnDesktop())) {
+            g.startupState = STARTUP_NORMAL;
+            g.lastActiveTime = now;
+        }
+    }
+    else { // 3: 正常运行阶段
+        UpdateActivity(now, isMoving);
+    }
+}
+
+// 正常运行阶段：鼠标在桌面上移动时显示，静止超过 hideDelayMs 后隐藏
+void UpdateActivity(ULONGLONG now, bool isMoving) {
+    if (isMoving) {
+        if (IsMouseOnDesktop()) {
+            // 只有桌面上的鼠标移动算作活动，其他输入 (键盘、其他窗口中的操作) 不推迟隐藏
+            g.lastActiveTime = now;
+            g.targetY = 0.0f;
+            g.targetAlpha = 255.0f;
+            g.isHidden = false;
+        }
+    }
+    else {
+        if (!g.isHidden && (now - g.lastActiveTime > g.cfg->hideDelayMs)) {
+            g.targetY = (float)g.screenH;
+            g.targetAlpha = 0.0f;
+            g.isHidden = true;
+        }
+    }
+}
+
 void ForceShowImmediate() {
     g.startupState = STARTUP_NORMAL; g.isHidden = false;
-    g.lastActiveTime = GetTickCount64();
+    g.lastActiveTime = g_Clock->tickMs();
     g.targetY = 0.0f; g.targetAlpha = 255.0f;
-    g.currentY = 0.0f; g.currentAlpha = 255.0f;
-    g.velocityY = 0.0f; g.velocityAlpha = 0.0f;
-    g.lastRenderY = -99999; g.lastRenderAlpha = -1;
-    TimerGetDelta(true); UpdatePhysics(0.0f);
+    g.jumpY = 0.0f; g.jumpAlpha = 255.0f; g.jumpSeq++;
+    g.resyncSeq++;
+    PublishAnimSnapshot();
+}
+
+// 应用当前的配置与蒙版选项，按需创建或销毁遮罩窗口。
+// 只有新建的遮罩 (或 reattachMask 时) 挂到桌面：挂接会把遮罩复位到透明与顶端，
+// 已显示的遮罩由渲染线程按重新同步的快照更新位置与透明度
+void ApplySettings(HINSTANCE hInstance, bool reattachMask) {
+    int maxMaskAlpha = MASK_OPTIONS[g.maskOptIndex].alpha;
+    if (maxMaskAlpha <= 0) DestroyMaskWindow(); // 先于配置变化，过渡快照只去掉遮罩句柄
+
+    g.cfg = &PRESETS[g.cfgIndex];
+    g.maxMaskAlpha = maxMaskAlpha;
+    SaveSettings();
+
+    if (g.maxMaskAlpha > 0) {
+        if (!g.hMaskWindow || !IsWindow(g.hMaskWindow)) {
+            CreateMaskWindow(hInstance);
+            reattachMask = true;
+        }
+        if (reattachMask) AttachMaskToDesktop();
+    }
 }
 
-void TriggerRestartAnimation() {
-    g.startupState = STARTUP_PHASE_1_HIDING;
-    g.startupPhaseStartTime = GetTickCount64();
-    g.targetY = (float)g.screenH; g.targetAlpha = 0.0f; g.isHidden = true;
+// 菜单切换配置或蒙版时直接热切换，不再经过隐藏/等待/显示。
+// 通道的弹簧指针随配置改变，下一步即以当前位置与速度为起点按新弹簧重新起段，动量得以保留
+void HotSwapSettings() {
+    ApplySettings(GetModuleHandle(NULL), false);
+
+    // 切换本身是一次用户操作：结束尚未完成的启动流程，转入显示
+    g.startupState = STARTUP_NORMAL;
+    g.isHidden = false;
+    g.targetY = 0.0f; g.targetAlpha = 255.0f;
+    g.lastActiveTime = g_Clock->tickMs();
+
+    // 强制下一次提交同步位置与透明度，已有的遮罩由此接续新配置，新建的遮罩由此显示
+    g.resyncSeq++;
+    PublishAnimSnapshot();
 }
\ No newline at end of file